@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+static
+void bitvector_push_back_obitvector(benchmark::State& state)
+{
+	auto n = state.range(0);
+
+	for(auto _ : state)
+	{
+		auto v = mgrech::obitvector::with_max_size_or_null(n);
+
+		for(int i = 0; i != n; ++i)
+			v.push_back(i % 3 == 0);
+
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+static
+void bitvector_push_back_std_vector_bool(benchmark::State& state)
+{
+	auto n = state.range(0);
+
+	for(auto _ : state)
+	{
+		std::vector<bool> v;
+		v.reserve(n);
+
+		for(int i = 0; i != n; ++i)
+			v.push_back(i % 3 == 0);
+
+		benchmark::DoNotOptimize(&v);
+	}
+}
+
+static
+void bitvector_count_obitvector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = mgrech::obitvector::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i % 3 == 0);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(v.count());
+}
+
+static
+void bitvector_count_std_vector_bool(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<bool> v;
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i % 3 == 0);
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::count(v.begin(), v.end(), true));
+}
+
+// 1024 rank queries spread over the whole vector, n is a power of two
+static
+void bitvector_rank(benchmark::State& state, bool rank_index)
+{
+	auto n = state.range(0);
+	auto v = mgrech::obitvector::with_max_size_or_null(n, rank_index);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i % 3 == 0);
+
+	for(auto _ : state)
+	{
+		std::size_t total = 0;
+
+		for(std::size_t i = 0; i != 1024; ++i)
+			total += v.rank(i * 0x9e3779b9u & (std::size_t)(n - 1));
+
+		benchmark::DoNotOptimize(total);
+	}
+}
+
+static
+void bitvector_rank_indexed(benchmark::State& state)
+{
+	bitvector_rank(state, true);
+}
+
+static
+void bitvector_rank_unindexed(benchmark::State& state)
+{
+	bitvector_rank(state, false);
+}
+
+BENCHMARK(bitvector_push_back_obitvector)     ->RangeMultiplier(32)->Range(1024, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitvector_push_back_std_vector_bool)->RangeMultiplier(32)->Range(1024, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitvector_count_obitvector)         ->RangeMultiplier(32)->Range(1024, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitvector_count_std_vector_bool)    ->RangeMultiplier(32)->Range(1024, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitvector_rank_indexed)             ->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitvector_rank_unindexed)           ->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
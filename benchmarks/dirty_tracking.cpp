@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// every iteration modifies one element per 64 KiB, appends 1024 elements and then brings a persisted copy up to date.
+// the appended elements are dropped again every 64 iterations to keep the size bounded.
+
+constexpr int APPEND = 1024;
+constexpr int MAX_APPENDED = 64 * APPEND;
+
+static
+void dirty_tracking_full_copy(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n + MAX_APPENDED);
+	std::vector<int> persisted(n + MAX_APPENDED);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		for(int i = 0; i < n; i += 16384)
+			++v[i];
+
+		if(v.size() == v.max_size())
+			v.erase(v.begin() + n, v.end());
+
+		for(int i = 0; i != APPEND; ++i)
+			v.push_back(i);
+
+		std::memcpy(persisted.data(), v.data(), v.size() * sizeof(int));
+		benchmark::DoNotOptimize(persisted.data());
+	}
+}
+
+static
+void dirty_tracking(benchmark::State& state, mgrech::dirty_tracking tracking)
+{
+	auto n = state.range(0);
+	mgrech::ovector_options options;
+	options.track_dirty_pages = tracking;
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n + MAX_APPENDED, options);
+	std::vector<int> persisted(n + MAX_APPENDED);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		for(int i = 0; i < n; i += 16384)
+			++v[i];
+
+		if(v.size() == v.max_size())
+			v.erase(v.begin() + n, v.end());
+
+		for(int i = 0; i != APPEND; ++i)
+			v.push_back(i);
+
+		v.collect_dirty_ranges([&](std::size_t first, std::size_t last)
+		{
+			std::memcpy(persisted.data() + first, v.data() + first, (last - first) * sizeof(int));
+		});
+
+		benchmark::DoNotOptimize(persisted.data());
+	}
+}
+
+static
+void dirty_tracking_automatic(benchmark::State& state)
+{
+	dirty_tracking(state, mgrech::dirty_tracking::automatic);
+}
+
+static
+void dirty_tracking_mprotect(benchmark::State& state)
+{
+	dirty_tracking(state, mgrech::dirty_tracking::mprotect);
+}
+
+BENCHMARK(dirty_tracking_automatic)->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(dirty_tracking_mprotect) ->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(dirty_tracking_full_copy)->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
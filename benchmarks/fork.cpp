@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// a process holding a fully populated 1 GiB ovector forks a child that exits right away. fork_only measures the
+// fork itself, which copies the page tables of inherited storage. fork_and_write additionally has the parent write
+// to every page while the child is still alive, which takes a copy-on-write fault per page of inherited storage.
+
+constexpr std::int64_t SIZE = 1024 * 1024 * 1024;
+constexpr std::int64_t PAGE = 4096;
+
+static
+mgrech::ovector<char> populated(mgrech::fork_policy policy)
+{
+	mgrech::ovector_options options;
+	options.on_fork = policy;
+	auto v = mgrech::ovector<char>::with_max_size_or_null(SIZE, options);
+	v.uninitialized_grow_back_by(SIZE);
+	std::memset(v.data(), 1, SIZE);
+	return v;
+}
+
+static
+void fork_only(benchmark::State& state, mgrech::fork_policy policy)
+{
+	auto v = populated(policy);
+
+	for(auto _ : state)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto pid = fork();
+
+		if(pid == 0)
+			_exit(0);
+
+		auto end = std::chrono::steady_clock::now();
+		waitpid(pid, nullptr, 0);
+		state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+	}
+}
+
+static
+void fork_and_write(benchmark::State& state, mgrech::fork_policy policy)
+{
+	auto v = populated(policy);
+	int pipefd[2];
+
+	for(auto _ : state)
+	{
+		if(pipe(pipefd) == -1)
+		{
+			state.SkipWithError("pipe failed");
+			break;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto pid = fork();
+
+		// the child waits for the parent to close the pipe, so that it keeps sharing the pages until then
+		if(pid == 0)
+		{
+			char c;
+			close(pipefd[1]);
+			while(read(pipefd[0], &c, 1) > 0) {}
+			_exit(0);
+		}
+
+		for(std::int64_t i = 0; i < SIZE; i += PAGE)
+			v[(std::size_t)i] = 2;
+
+		auto end = std::chrono::steady_clock::now();
+		close(pipefd[0]);
+		close(pipefd[1]);
+		waitpid(pid, nullptr, 0);
+		state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+	}
+}
+
+static
+void fork_only_inherit(benchmark::State& state)
+{
+	fork_only(state, mgrech::fork_policy::inherit);
+}
+
+static
+void fork_only_dont_fork(benchmark::State& state)
+{
+	fork_only(state, mgrech::fork_policy::dont_fork);
+}
+
+static
+void fork_only_wipe_on_fork(benchmark::State& state)
+{
+	fork_only(state, mgrech::fork_policy::wipe_on_fork);
+}
+
+static
+void fork_and_write_inherit(benchmark::State& state)
+{
+	fork_and_write(state, mgrech::fork_policy::inherit);
+}
+
+static
+void fork_and_write_dont_fork(benchmark::State& state)
+{
+	fork_and_write(state, mgrech::fork_policy::dont_fork);
+}
+
+static
+void fork_and_write_wipe_on_fork(benchmark::State& state)
+{
+	fork_and_write(state, mgrech::fork_policy::wipe_on_fork);
+}
+
+BENCHMARK(fork_only_inherit)          ->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(fork_only_dont_fork)        ->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(fork_only_wipe_on_fork)     ->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(fork_and_write_inherit)     ->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(fork_and_write_dont_fork)   ->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(fork_and_write_wipe_on_fork)->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// not trivially copyable, but safe to relocate with memmove
+using unique_int = std::unique_ptr<int>;
+
+namespace mgrech
+{
+	template <>
+	struct is_trivially_relocatable<unique_int> : std::true_type
+	{};
+}
+
+template <typename T>
+static
+std::vector<T> make_std_vector(int n)
+{
+	std::vector<T> v;
+	v.reserve(n + 1);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(T());
+
+	return v;
+}
+
+template <typename T>
+static
+mgrech::ovector<T> make_ovector(int n)
+{
+	auto v = mgrech::ovector<T>::with_max_size_or_null(n + 1);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(T());
+
+	return v;
+}
+
+template <typename T>
+static
+void erase_front_std_vector(benchmark::State& state)
+{
+	auto v = make_std_vector<T>(state.range(0));
+
+	for(auto _ : state)
+	{
+		v.erase(v.begin());
+		v.push_back(T());
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void erase_front_ovector(benchmark::State& state)
+{
+	auto v = make_ovector<T>(state.range(0));
+
+	for(auto _ : state)
+	{
+		v.erase(v.begin());
+		v.push_back(T());
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void insert_front_std_vector(benchmark::State& state)
+{
+	auto v = make_std_vector<T>(state.range(0));
+	T value[1] = {};
+
+	for(auto _ : state)
+	{
+		v.insert(v.begin(), std::make_move_iterator(value), std::make_move_iterator(value + 1));
+		v.pop_back();
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void insert_front_ovector(benchmark::State& state)
+{
+	auto v = make_ovector<T>(state.range(0));
+	T value[1] = {};
+
+	for(auto _ : state)
+	{
+		v.insert(v.begin(), std::make_move_iterator(value), std::make_move_iterator(value + 1));
+		v.pop_back();
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void swap_remove_std_vector(benchmark::State& state)
+{
+	auto v = make_std_vector<T>(state.range(0));
+
+	for(auto _ : state)
+	{
+		v[0] = std::move(v.back());
+		v.pop_back();
+		v.push_back(T());
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void swap_remove_ovector(benchmark::State& state)
+{
+	auto v = make_ovector<T>(state.range(0));
+
+	for(auto _ : state)
+	{
+		v.swap_remove(0);
+		v.push_back(T());
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void erase_if_std_vector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = make_std_vector<T>(n);
+
+	for(auto _ : state)
+	{
+		int i = 0;
+		v.erase(std::remove_if(v.begin(), v.end(), [&](T const&) { return i++ % 2 == 0; }), v.end());
+
+		while(v.size() != (std::size_t)n)
+			v.push_back(T());
+
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+template <typename T>
+static
+void erase_if_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = make_ovector<T>(n);
+
+	for(auto _ : state)
+	{
+		int i = 0;
+		v.erase_if([&](T const&) { return i++ % 2 == 0; });
+
+		while(v.size() != (std::size_t)n)
+			v.push_back(T());
+
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
+#define OV_BENCHMARK(name, type) \
+	BENCHMARK_TEMPLATE(name, type)->RangeMultiplier(32)->Range(32, 1024*1024)->Unit(benchmark::kMicrosecond)
+
+OV_BENCHMARK(erase_front_ovector,     int);
+OV_BENCHMARK(erase_front_std_vector,  int);
+OV_BENCHMARK(erase_front_ovector,     unique_int);
+OV_BENCHMARK(erase_front_std_vector,  unique_int);
+OV_BENCHMARK(insert_front_ovector,    int);
+OV_BENCHMARK(insert_front_std_vector, int);
+OV_BENCHMARK(insert_front_ovector,    unique_int);
+OV_BENCHMARK(insert_front_std_vector, unique_int);
+OV_BENCHMARK(swap_remove_ovector,     int);
+OV_BENCHMARK(swap_remove_std_vector,  int);
+OV_BENCHMARK(swap_remove_ovector,     unique_int);
+OV_BENCHMARK(swap_remove_std_vector,  unique_int);
+OV_BENCHMARK(erase_if_ovector,        int);
+OV_BENCHMARK(erase_if_std_vector,     int);
+OV_BENCHMARK(erase_if_ovector,        unique_int);
+OV_BENCHMARK(erase_if_std_vector,     unique_int);
+BENCHMARK_MAIN();
@@ -0,0 +1,452 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <csignal>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// counts the user-space instructions retired per operation on the hot paths and compares them with the baseline
+// in instructions.txt, which catches a missing OVECTOR_FORCE_INLINE or an extra call long before it shows up in
+// timings. the debug build compiles the operations without optimizations, see noopt.hpp.
+//
+// usage: bench-instructions-<config> [baseline file [--update]]
+// exits with 1 if an operation takes more instructions than its baseline allows, and with 77 if instructions cannot
+// be counted or the baseline was recorded with another compiler or build type, whose counts differ.
+// --update writes the measured counts of this configuration to the baseline file instead.
+//
+// instructions are counted with perf_event_open. where there are no hardware counters, e.g. in many virtual machines,
+// the operations run in a child process that is single-stepped with ptrace instead, which counts each iteration of
+// a rep-prefixed instruction separately but agrees otherwise.
+
+#ifdef OVECTOR_BENCHMARK_DEBUG
+static char const* const CONFIG = "debug";
+#else
+static char const* const CONFIG = "release";
+#endif
+
+#define OVECTOR_STRINGIFY_(x) #x
+#define OVECTOR_STRINGIFY(x) OVECTOR_STRINGIFY_(x)
+
+// clang must be checked before gcc as it defines __GNUC__ as well
+#if defined(__clang__)
+#  define OVECTOR_COMPILER "clang-" OVECTOR_STRINGIFY(__clang_major__) "." OVECTOR_STRINGIFY(__clang_minor__) "." \
+                           OVECTOR_STRINGIFY(__clang_patchlevel__)
+#elif defined(__GNUC__)
+#  define OVECTOR_COMPILER "gcc-" OVECTOR_STRINGIFY(__GNUC__) "." OVECTOR_STRINGIFY(__GNUC_MINOR__) "." \
+                           OVECTOR_STRINGIFY(__GNUC_PATCHLEVEL__)
+#elif defined(_MSC_VER)
+#  define OVECTOR_COMPILER "msvc-" OVECTOR_STRINGIFY(_MSC_FULL_VER)
+#else
+#  define OVECTOR_COMPILER "unknown"
+#endif
+
+// set by benchmarks/CMakeLists.txt to CMAKE_BUILD_TYPE, which selects the optimization flags
+#ifndef OVECTOR_BENCHMARK_BUILD_TYPE
+#  define OVECTOR_BENCHMARK_BUILD_TYPE "unknown"
+#endif
+
+// the counts only hold for the compiler and build type they were recorded with
+static char const* const BUILD = OVECTOR_COMPILER "/" OVECTOR_BENCHMARK_BUILD_TYPE;
+
+// an operation may take this many more instructions than its baseline, relative and absolute
+constexpr double TOLERANCE = 0.05;
+constexpr double TOLERANCE_ABSOLUTE = 0.5;
+
+// operations per measurement with hardware counters and when single-stepping
+constexpr std::int64_t COUNTED_OPERATIONS = 1024 * 1024;
+constexpr std::int64_t STEPPED_OPERATIONS = 4096;
+
+// volatile, so that the compiler cannot turn the destructor calls of a clear into a single addition
+static volatile int destroyed;
+
+struct nontrivial
+{
+	int value;
+
+	~nontrivial()
+	{
+		destroyed = destroyed + 1;
+	}
+};
+
+static mgrech::ovector<int> ints;
+static mgrech::ovector<nontrivial> objects;
+static volatile long long sink;
+
+static
+void setup_none(std::int64_t n)
+{
+	(void)n;
+}
+
+static
+void run_none(std::int64_t n)
+{
+	(void)n;
+}
+
+static
+void setup_push_back(std::int64_t n)
+{
+	ints = mgrech::ovector<int>::with_max_size_or_null(n);
+}
+
+static
+void run_push_back(std::int64_t n)
+{
+	for(int i = 0; i != n; ++i)
+		ints.push_back(i);
+}
+
+static
+void setup_iterate(std::int64_t n)
+{
+	ints = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		ints.push_back(i);
+}
+
+static
+void run_iterate(std::int64_t n)
+{
+	(void)n;
+	long long sum = 0;
+
+	for(auto x : ints)
+		sum += x;
+
+	sink = sum;
+}
+
+static
+void setup_clear(std::int64_t n)
+{
+	(void)n;
+	ints = mgrech::ovector<int>::with_max_size_or_null(1);
+}
+
+static
+void run_clear(std::int64_t n)
+{
+	// keeps the compiler from merging the clears into one, which would measure nothing
+	for(std::int64_t i = 0; i != n; ++i)
+	{
+		ints.clear();
+		benchmark::ClobberMemory();
+	}
+}
+
+static
+void setup_clear_nontrivial(std::int64_t n)
+{
+	objects = mgrech::ovector<nontrivial>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		objects.push_back(nontrivial{i});
+}
+
+static
+void run_clear_nontrivial(std::int64_t n)
+{
+	(void)n;
+	objects.clear();
+}
+
+struct operation
+{
+	char const* name;
+	// prepares n operations outside of the counted region
+	void (*setup)(std::int64_t n);
+	void (*run)(std::int64_t n);
+};
+
+static operation const OPERATIONS[] =
+{
+	{"push_back",        setup_push_back,        run_push_back},
+	{"iterate",          setup_iterate,          run_iterate},
+	{"clear",            setup_clear,            run_clear},
+	{"clear_nontrivial", setup_clear_nontrivial, run_clear_nontrivial},
+};
+
+static operation const NONE = {"none", setup_none, run_none};
+
+#ifdef __linux__
+
+static
+int open_instruction_counter()
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	// page faults of the first touch of a page are not part of the operations
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// returns the number of instructions or -1 on failure
+static
+long long count_with_perf(int fd, operation const& op, std::int64_t n)
+{
+	op.setup(n);
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	op.run(n);
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	std::uint64_t count;
+	return read(fd, &count, sizeof(count)) == sizeof(count) ? (long long)count : -1;
+}
+
+// runs the operation in a child that stops right before and after it, and single-steps the child in between.
+// returns the number of steps or -1 on failure.
+static
+long long count_with_ptrace(operation const& op, std::int64_t n)
+{
+	auto pid = fork();
+
+	if(pid == -1)
+		return -1;
+
+	if(pid == 0)
+	{
+		op.setup(n);
+
+		if(ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == -1)
+			_exit(1);
+
+		raise(SIGSTOP);
+		op.run(n);
+		raise(SIGSTOP);
+		_exit(0);
+	}
+
+	int status;
+	long long steps = 0;
+
+	if(waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status))
+		return -1;
+
+	for(;;)
+	{
+		if(ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr) == -1 || waitpid(pid, &status, 0) != pid)
+		{
+			steps = -1;
+			break;
+		}
+
+		if(!WIFSTOPPED(status))
+		{
+			steps = -1;
+			break;
+		}
+
+		if(WSTOPSIG(status) != SIGTRAP)
+			break;
+
+		++steps;
+	}
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+	return steps;
+}
+
+// measures the instructions per operation, or returns false if they cannot be counted
+static
+bool measure(std::vector<double>& counts)
+{
+	auto fd = open_instruction_counter();
+	auto n = fd != -1 ? COUNTED_OPERATIONS : STEPPED_OPERATIONS;
+
+	auto count = [&](operation const& op)
+	{
+		return fd != -1 ? count_with_perf(fd, op, n) : count_with_ptrace(op, n);
+	};
+
+	std::printf("counting with %s, %lld operations each\n", fd != -1 ? "perf_event_open" : "ptrace", (long long)n);
+
+	// the instructions around the counted region
+	auto overhead = count(NONE);
+	auto ok = overhead >= 0;
+
+	for(std::size_t i = 0; ok && i != sizeof(OPERATIONS) / sizeof(OPERATIONS[0]); ++i)
+	{
+		auto total = count(OPERATIONS[i]);
+		ok = total >= 0;
+		counts.push_back((double)(total - overhead) / (double)n);
+	}
+
+	if(fd != -1)
+		close(fd);
+
+	return ok;
+}
+
+#else
+
+static
+bool measure(std::vector<double>& counts)
+{
+	(void)counts;
+	return false;
+}
+
+#endif
+
+struct baseline_entry
+{
+	std::string config;
+	std::string operation;
+	double instructions;
+};
+
+// reads the entries and the build they were recorded with, which stays empty if the file does not name it
+static
+std::vector<baseline_entry> read_baseline(char const* path, std::string& build)
+{
+	std::vector<baseline_entry> entries;
+	auto file = std::fopen(path, "r");
+
+	if(!file)
+		return entries;
+
+	char line[256];
+
+	while(std::fgets(line, sizeof(line), file))
+	{
+		char config[64];
+		char operation[64];
+		double instructions;
+
+		if(std::sscanf(line, "# build: %63s", config) == 1)
+			build = config;
+		else if(line[0] != '#' && std::sscanf(line, "%63s %63s %lf", config, operation, &instructions) == 3)
+			entries.push_back(baseline_entry{config, operation, instructions});
+	}
+
+	std::fclose(file);
+	return entries;
+}
+
+static
+bool write_baseline(char const* path, std::vector<baseline_entry> const& entries)
+{
+	auto file = std::fopen(path, "w");
+
+	if(!file)
+		return false;
+
+	std::fprintf(file, "# user-space instructions retired per operation, see instructions.cpp\n");
+	std::fprintf(file, "# regenerate with: bench-instructions-<config> instructions.txt --update\n");
+
+	std::fprintf(file, "# build: %s\n", BUILD);
+
+	for(auto& entry : entries)
+		std::fprintf(file, "%s %s %.2f\n", entry.config.c_str(), entry.operation.c_str(), entry.instructions);
+
+	return std::fclose(file) == 0;
+}
+
+static
+baseline_entry* find_entry(std::vector<baseline_entry>& entries, char const* operation)
+{
+	for(auto& entry : entries)
+		if(entry.config == CONFIG && entry.operation == operation)
+			return &entry;
+
+	return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	auto path = argc > 1 ? argv[1] : nullptr;
+	auto update = argc > 2 && std::strcmp(argv[2], "--update") == 0;
+
+	std::string build;
+	auto baseline = path ? read_baseline(path, build) : std::vector<baseline_entry>();
+
+	if(path && !update && build != BUILD)
+	{
+		std::printf("the baseline was recorded with %s, not %s\n", build.empty() ? "an unknown build" : build.c_str(),
+		            BUILD);
+		return 77;
+	}
+
+	std::vector<double> counts;
+
+	if(!measure(counts))
+	{
+		std::printf("instructions cannot be counted on this system\n");
+		return 77;
+	}
+
+	auto regressions = 0;
+
+	std::printf("%-8s %-18s %12s %12s\n", "config", "operation", "instructions", "baseline");
+
+	for(std::size_t i = 0; i != counts.size(); ++i)
+	{
+		auto name = OPERATIONS[i].name;
+		auto entry = find_entry(baseline, name);
+
+		if(update)
+		{
+			if(entry)
+				entry->instructions = counts[i];
+			else
+				baseline.push_back(baseline_entry{CONFIG, name, counts[i]});
+
+			std::printf("%-8s %-18s %12.2f\n", CONFIG, name, counts[i]);
+			continue;
+		}
+
+		if(!entry)
+		{
+			std::printf("%-8s %-18s %12.2f %12s\n", CONFIG, name, counts[i], "none");
+			continue;
+		}
+
+		auto limit = entry->instructions * (1 + TOLERANCE);
+
+		if(limit < entry->instructions + TOLERANCE_ABSOLUTE)
+			limit = entry->instructions + TOLERANCE_ABSOLUTE;
+
+		auto regressed = counts[i] > limit;
+		regressions += regressed;
+		std::printf("%-8s %-18s %12.2f %12.2f%s\n", CONFIG, name, counts[i], entry->instructions,
+		            regressed ? "  REGRESSION" : "");
+	}
+
+	if(update)
+	{
+		if(!path || !write_baseline(path, baseline))
+		{
+			std::printf("failed to write the baseline\n");
+			return 1;
+		}
+
+		return 0;
+	}
+
+	return regressions ? 1 : 0;
+}
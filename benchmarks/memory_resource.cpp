@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// every iteration builds the object graph of a request: a vector of strings too long for the small string
+// optimization and a map, then frees everything at once
+
+static
+void build_request(std::pmr::memory_resource* resource, int n)
+{
+	std::pmr::vector<std::pmr::string> strings(resource);
+	std::pmr::map<int, int> map(resource);
+
+	for(int i = 0; i != n; ++i)
+	{
+		strings.emplace_back("a string that does not fit into the small string buffer");
+		map.emplace(i, i);
+	}
+
+	benchmark::DoNotOptimize(strings.data());
+	benchmark::DoNotOptimize(&map);
+}
+
+static
+void memory_resource_ovector(benchmark::State& state)
+{
+	auto n = (int)state.range(0);
+	auto resource = mgrech::ovector_memory_resource::with_max_size_or_null(1024 * 1024 * 1024);
+
+	for(auto _ : state)
+	{
+		build_request(&resource, n);
+		resource.release();
+	}
+}
+
+static
+void memory_resource_monotonic_buffer(benchmark::State& state)
+{
+	auto n = (int)state.range(0);
+	std::pmr::monotonic_buffer_resource resource(std::pmr::new_delete_resource());
+
+	for(auto _ : state)
+	{
+		build_request(&resource, n);
+		resource.release();
+	}
+}
+
+static
+void memory_resource_new_delete(benchmark::State& state)
+{
+	auto n = (int)state.range(0);
+
+	for(auto _ : state)
+		build_request(std::pmr::new_delete_resource(), n);
+}
+
+BENCHMARK(memory_resource_ovector)         ->RangeMultiplier(8)->Range(8, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(memory_resource_monotonic_buffer)->RangeMultiplier(8)->Range(8, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(memory_resource_new_delete)      ->RangeMultiplier(8)->Range(8, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
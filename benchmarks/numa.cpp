@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// the ovector is filled by one thread and then scanned by all of them, each summing its own partition. without a
+// policy all pages end up on the node of the filling thread.
+
+constexpr std::int64_t SIZE = 64 * 1024 * 1024;
+
+static mgrech::ovector<int> shared;
+
+static
+void numa_scan(benchmark::State& state, mgrech::numa_policy policy)
+{
+	if(state.thread_index == 0)
+	{
+		mgrech::ovector_options options;
+		options.placement = policy;
+		shared = mgrech::ovector<int>::with_max_size_or_null(SIZE, options);
+
+		for(int i = 0; i != SIZE; ++i)
+			shared.push_back(i);
+	}
+
+	for(auto _ : state)
+	{
+		auto partition = SIZE / state.threads;
+		auto first = shared.data() + partition * state.thread_index;
+		long long sum = 0;
+
+		for(auto p = first; p != first + partition; ++p)
+			sum += *p;
+
+		benchmark::DoNotOptimize(sum);
+	}
+
+	if(state.thread_index == 0)
+		shared = mgrech::ovector<int>();
+}
+
+static
+void numa_scan_inherit(benchmark::State& state)
+{
+	numa_scan(state, mgrech::numa_policy::inherit);
+}
+
+static
+void numa_scan_interleave(benchmark::State& state)
+{
+	numa_scan(state, mgrech::numa_policy::interleave);
+}
+
+BENCHMARK(numa_scan_inherit)   ->ThreadRange(1, 64)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(numa_scan_interleave)->ThreadRange(1, 64)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
@@ -54,7 +54,33 @@ void push_back_ovector(benchmark::State& state)
 	}
 }
 
+static
+void push_back_ovector_demote(benchmark::State& state)
+{
+	auto n = state.range(0);
+
+	mgrech::ovector_options options;
+	options.demote_behind_pages = 256;
+
+	for(auto _ : state)
+	{
+		auto v = mgrech::ovector<int>::with_max_size_or_null(n, options);
+
+		for(int i = 0; i != n; ++i)
+		{
+			v.push_back(i);
+
+			// a page of ints
+			if(i % 1024 == 1023)
+				v.demote_cold_prefix();
+		}
+
+		benchmark::DoNotOptimize(v.data());
+	}
+}
+
 BENCHMARK(push_back_ovector)           ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(push_back_ovector_demote)    ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
 BENCHMARK(push_back_std_vector)        ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
 BENCHMARK(push_back_std_vector_reserve)->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
 BENCHMARK_MAIN();
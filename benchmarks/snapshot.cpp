@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// every iteration modifies one element per 64 KiB and then takes a point-in-time copy
+
+static
+void snapshot_std_vector_copy(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<int> v;
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		for(int i = 0; i < n; i += 16384)
+			++v[i];
+
+		std::vector<int> copy(v);
+		benchmark::DoNotOptimize(copy.data());
+	}
+}
+
+static
+void snapshot_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	mgrech::ovector_options options;
+	options.snapshots = true;
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n, options);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		for(int i = 0; i < n; i += 16384)
+			++v[i];
+
+		auto snapshot = v.snapshot();
+		benchmark::DoNotOptimize(snapshot.data());
+	}
+}
+
+// every iteration appends n elements and takes a new snapshot in place of the previous one. the time per iteration
+// stays flat as the ovector grows, because a snapshot only writes back the pages modified since the previous one.
+static
+void snapshot_ovector_repeated_append(benchmark::State& state)
+{
+	auto n = state.range(0);
+	mgrech::ovector_options options;
+	options.snapshots = true;
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n * state.max_iterations, options);
+	mgrech::ovector_snapshot<int> snapshot;
+
+	for(auto _ : state)
+	{
+		for(int i = 0; i != n; ++i)
+			v.push_back(i);
+
+		snapshot = v.snapshot();
+		benchmark::DoNotOptimize(snapshot.data());
+	}
+}
+
+BENCHMARK(snapshot_ovector)        ->RangeMultiplier(32)->Range(1024, 256*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(snapshot_std_vector_copy)->RangeMultiplier(32)->Range(1024, 256*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(snapshot_ovector_repeated_append)->Arg(1024)->Arg(16384)->Iterations(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
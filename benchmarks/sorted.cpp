@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// random 64-bit keys inserted one at a time, then looked up in a different random order. the sorted_ovector seals
+// its buffer every BUFFER_SIZE elements, the sorted std::vector inserts every key at its position.
+
+constexpr std::int64_t BUFFER_SIZE = 1024;
+
+using sorted = mgrech::sorted_ovector<std::uint64_t>;
+
+static
+std::vector<std::uint64_t> random_keys(std::int64_t n)
+{
+	std::mt19937_64 rng(42);
+	std::vector<std::uint64_t> keys((std::size_t)n);
+
+	for(auto& key : keys)
+		key = rng();
+
+	return keys;
+}
+
+static
+std::vector<std::uint64_t> shuffled(std::vector<std::uint64_t> keys)
+{
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(43));
+	return keys;
+}
+
+static
+void insert_sorted_ovector(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+
+	for(auto _ : state)
+	{
+		auto s = sorted::with_buffer_size_or_null(BUFFER_SIZE);
+
+		for(auto key : keys)
+			s.insert(key);
+
+		benchmark::DoNotOptimize(s.size());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static
+void insert_map(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+
+	for(auto _ : state)
+	{
+		std::map<std::uint64_t, char> m;
+
+		for(auto key : keys)
+			m.emplace(key, 0);
+
+		benchmark::DoNotOptimize(m.size());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static
+void insert_sorted_vector(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+
+	for(auto _ : state)
+	{
+		std::vector<std::uint64_t> v;
+
+		for(auto key : keys)
+			v.insert(std::lower_bound(v.begin(), v.end(), key), key);
+
+		benchmark::DoNotOptimize(v.size());
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Lookup>
+static
+void lookup(benchmark::State& state, std::vector<std::uint64_t> const& keys, Lookup f)
+{
+	std::size_t i = 0;
+
+	for(auto _ : state)
+	{
+		auto found = f(keys[i]);
+		benchmark::DoNotOptimize(found);
+
+		if(++i == keys.size())
+			i = 0;
+	}
+}
+
+static
+void lookup_sorted_ovector(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+	auto s = sorted::with_buffer_size_or_null(BUFFER_SIZE);
+
+	for(auto key : keys)
+		s.insert(key);
+
+	state.counters["runs"] = (double)s.run_count();
+	lookup(state, shuffled(keys), [&](std::uint64_t key) { return s.find(key); });
+}
+
+static
+void lookup_sorted_ovector_compacted(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+	auto s = sorted::with_buffer_size_or_null(BUFFER_SIZE);
+
+	for(auto key : keys)
+		s.insert(key);
+
+	s.compact();
+	lookup(state, shuffled(keys), [&](std::uint64_t key) { return s.find(key); });
+}
+
+static
+void lookup_map(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+	std::map<std::uint64_t, char> m;
+
+	for(auto key : keys)
+		m.emplace(key, 0);
+
+	lookup(state, shuffled(keys), [&](std::uint64_t key) { return &*m.find(key); });
+}
+
+static
+void lookup_sorted_vector(benchmark::State& state)
+{
+	auto keys = random_keys(state.range(0));
+	auto v = keys;
+	std::sort(v.begin(), v.end());
+
+	lookup(state, shuffled(keys), [&](std::uint64_t key) { return &*std::lower_bound(v.begin(), v.end(), key); });
+}
+
+BENCHMARK(insert_sorted_ovector)          ->RangeMultiplier(8)->Range(4096, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(insert_map)                     ->RangeMultiplier(8)->Range(4096, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(insert_sorted_vector)           ->RangeMultiplier(8)->Range(4096, 256*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(lookup_sorted_ovector)          ->RangeMultiplier(8)->Range(4096, 2*1024*1024);
+BENCHMARK(lookup_sorted_ovector_compacted)->RangeMultiplier(8)->Range(4096, 2*1024*1024);
+BENCHMARK(lookup_map)                     ->RangeMultiplier(8)->Range(4096, 2*1024*1024);
+BENCHMARK(lookup_sorted_vector)           ->RangeMultiplier(8)->Range(4096, 2*1024*1024);
+BENCHMARK_MAIN();
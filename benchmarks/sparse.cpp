@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// ids drawn from a 26-bit range mapped to 8-byte records, looked up in random order. the sparse_ovector reserves
+// 512 MiB of address space and only commits the pages that are written to, with 512 ids per page.
+
+constexpr std::uint64_t ID_RANGE = std::uint64_t(1) << 26;
+
+static
+std::vector<std::uint64_t> random_ids(std::int64_t n)
+{
+	std::mt19937_64 rng(42);
+	std::vector<std::uint64_t> ids((std::size_t)n);
+
+	for(auto& id : ids)
+		id = rng() % ID_RANGE;
+
+	return ids;
+}
+
+static
+void lookup_sparse_ovector(benchmark::State& state)
+{
+	auto ids = random_ids(state.range(0));
+	auto v = mgrech::sparse_ovector<std::uint64_t>::with_max_size_or_null(ID_RANGE);
+
+	for(auto id : ids)
+		v.set(id, id + 1);
+
+	std::size_t i = 0;
+
+	for(auto _ : state)
+	{
+		auto value = v[ids[i]];
+		benchmark::DoNotOptimize(value);
+
+		if(++i == ids.size())
+			i = 0;
+	}
+
+	state.counters["pages"] = (double)v.populated_pages();
+}
+
+static
+void lookup_unordered_map(benchmark::State& state)
+{
+	auto ids = random_ids(state.range(0));
+	std::unordered_map<std::uint64_t, std::uint64_t> m;
+
+	for(auto id : ids)
+		m[id] = id + 1;
+
+	std::size_t i = 0;
+
+	for(auto _ : state)
+	{
+		auto value = m.find(ids[i])->second;
+		benchmark::DoNotOptimize(value);
+
+		if(++i == ids.size())
+			i = 0;
+	}
+}
+
+static
+void insert_erase_sparse_ovector(benchmark::State& state)
+{
+	auto ids = random_ids(state.range(0));
+	auto v = mgrech::sparse_ovector<std::uint64_t>::with_max_size_or_null(ID_RANGE);
+
+	for(auto _ : state)
+	{
+		for(auto id : ids)
+			v.set(id, id + 1);
+
+		for(auto id : ids)
+			v.erase(id);
+	}
+}
+
+static
+void insert_erase_unordered_map(benchmark::State& state)
+{
+	auto ids = random_ids(state.range(0));
+	std::unordered_map<std::uint64_t, std::uint64_t> m;
+
+	for(auto _ : state)
+	{
+		for(auto id : ids)
+			m[id] = id + 1;
+
+		for(auto id : ids)
+			m.erase(id);
+	}
+}
+
+BENCHMARK(lookup_sparse_ovector)      ->RangeMultiplier(32)->Range(1024, 1024*1024);
+BENCHMARK(lookup_unordered_map)       ->RangeMultiplier(32)->Range(1024, 1024*1024);
+BENCHMARK(insert_erase_sparse_ovector)->RangeMultiplier(32)->Range(1024, 1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(insert_erase_unordered_map) ->RangeMultiplier(32)->Range(1024, 1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,179 @@
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "noopt.hpp"
+#include <mgrech/ovector.hpp>
+
+// wake-up latency between two threads: each iteration appends a value to a stream the echo thread waits on and waits
+// for the echo thread to append it to a second stream. compared with a queue guarded by a mutex and a condition
+// variable, the usual way of handing values to a waiting thread.
+
+using stream = mgrech::ovector_stream<std::int64_t>;
+
+template <typename T>
+class cv_queue
+{
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<T> _items;
+	bool _closed = false;
+
+public:
+	void push(T value)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_items.push_back(value);
+		}
+
+		_condition.notify_one();
+	}
+
+	bool pop(T& value)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this] { return !_items.empty() || _closed; });
+
+		if(_items.empty())
+			return false;
+
+		value = _items.front();
+		_items.pop_front();
+		return true;
+	}
+
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_closed = true;
+		}
+
+		_condition.notify_all();
+	}
+};
+
+static
+void round_trip_ovector_stream(benchmark::State& state)
+{
+	auto n = (stream::size_type)state.max_iterations;
+	auto ping = stream::with_max_size_or_null(n);
+	auto pong = stream::with_max_size_or_null(n);
+
+	std::thread echo([&]
+	{
+		for(stream::size_type i = 0; ping.wait_until_size(i + 1); ++i)
+			pong.push_back(ping[i]);
+	});
+
+	std::int64_t i = 0;
+
+	for(auto _ : state)
+	{
+		ping.push_back(i);
+		pong.wait_until_size((stream::size_type)++i);
+	}
+
+	ping.close();
+	echo.join();
+}
+
+static
+void round_trip_cv_queue(benchmark::State& state)
+{
+	cv_queue<std::int64_t> ping;
+	cv_queue<std::int64_t> pong;
+
+	std::thread echo([&]
+	{
+		std::int64_t value;
+
+		while(ping.pop(value))
+			pong.push(value);
+	});
+
+	std::int64_t i = 0;
+
+	for(auto _ : state)
+	{
+		std::int64_t value;
+		ping.push(i++);
+		pong.pop(value);
+		benchmark::DoNotOptimize(value);
+	}
+
+	ping.close();
+	echo.join();
+}
+
+// throughput of a producer appending as fast as it can while a consumer tails the stream
+static
+void tail_ovector_stream(benchmark::State& state)
+{
+	auto n = state.range(0);
+
+	for(auto _ : state)
+	{
+		auto s = stream::with_max_size_or_null((stream::size_type)n);
+
+		std::thread consumer([&]
+		{
+			std::int64_t sum = 0;
+
+			for(stream::size_type i = 0; s.wait_until_size(i + 1);)
+			{
+				auto end = s.size();
+
+				for(; i != end; ++i)
+					sum += s[i];
+			}
+
+			benchmark::DoNotOptimize(sum);
+		});
+
+		for(std::int64_t i = 0; i != n; ++i)
+			s.push_back(i);
+
+		s.close();
+		consumer.join();
+	}
+}
+
+static
+void tail_cv_queue(benchmark::State& state)
+{
+	auto n = state.range(0);
+
+	for(auto _ : state)
+	{
+		cv_queue<std::int64_t> q;
+
+		std::thread consumer([&]
+		{
+			std::int64_t sum = 0;
+			std::int64_t value;
+
+			while(q.pop(value))
+				sum += value;
+
+			benchmark::DoNotOptimize(sum);
+		});
+
+		for(std::int64_t i = 0; i != n; ++i)
+			q.push(i);
+
+		q.close();
+		consumer.join();
+	}
+}
+
+BENCHMARK(round_trip_ovector_stream)->UseRealTime();
+BENCHMARK(round_trip_cv_queue)      ->UseRealTime();
+BENCHMARK(tail_ovector_stream)      ->Arg(1024*1024)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(tail_cv_queue)            ->Arg(1024*1024)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
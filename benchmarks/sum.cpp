@@ -1,5 +1,6 @@
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <vector>
 
@@ -46,6 +47,207 @@ void sum_ovector(benchmark::State& state)
 	}
 }
 
-BENCHMARK(sum_ovector)   ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
-BENCHMARK(sum_std_vector)->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+static
+void sum_ovector_kernel(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto sum = mgrech::sum(v);
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+// one element more than the range, which starts the storage 4 bytes before a 64 byte boundary unless aligned
+static
+void sum_ovector_kernel_alignment(benchmark::State& state, std::size_t alignment)
+{
+	auto n = state.range(0);
+	mgrech::ovector_options options;
+	options.alignment = alignment;
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n + 1, options);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto sum = mgrech::sum(v);
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+static
+void sum_ovector_kernel_aligned(benchmark::State& state)
+{
+	sum_ovector_kernel_alignment(state, 64);
+}
+
+static
+void sum_ovector_kernel_unaligned(benchmark::State& state)
+{
+	sum_ovector_kernel_alignment(state, 0);
+}
+
+static
+void equal_std_vector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<int> v1, v2;
+
+	for(int i = 0; i != n; ++i)
+	{
+		v1.push_back(i);
+		v2.push_back(i);
+	}
+
+	for(auto _ : state)
+	{
+		auto eq = v1 == v2;
+		benchmark::DoNotOptimize(eq);
+	}
+}
+
+static
+void equal_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v1 = mgrech::ovector<int>::with_max_size_or_null(n);
+	auto v2 = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+	{
+		v1.push_back(i);
+		v2.push_back(i);
+	}
+
+	for(auto _ : state)
+	{
+		auto eq = v1 == v2;
+		benchmark::DoNotOptimize(eq);
+	}
+}
+
+static
+void find_std_vector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<int> v;
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto p = std::find(v.begin(), v.end(), -1);
+		benchmark::DoNotOptimize(p);
+	}
+}
+
+static
+void find_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto p = mgrech::find(v, -1);
+		benchmark::DoNotOptimize(p);
+	}
+}
+
+static
+void max_std_vector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<int> v;
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto max = *std::max_element(v.begin(), v.end());
+		benchmark::DoNotOptimize(max);
+	}
+}
+
+static
+void max_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto v = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		v.push_back(i);
+
+	for(auto _ : state)
+	{
+		auto max = mgrech::max_value(v);
+		benchmark::DoNotOptimize(max);
+	}
+}
+
+static
+void compact_std_vector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	std::vector<int> src, dst;
+	dst.reserve(n);
+
+	for(int i = 0; i != n; ++i)
+		src.push_back(i);
+
+	for(auto _ : state)
+	{
+		dst.clear();
+
+		for(auto i : src)
+			if(i % 4 < 2)
+				dst.push_back(i);
+
+		benchmark::DoNotOptimize(dst.data());
+	}
+}
+
+static
+void compact_ovector(benchmark::State& state)
+{
+	auto n = state.range(0);
+	auto src = mgrech::ovector<int>::with_max_size_or_null(n);
+	auto dst = mgrech::ovector<int>::with_max_size_or_null(n);
+
+	for(int i = 0; i != n; ++i)
+		src.push_back(i % 4);
+
+	for(auto _ : state)
+	{
+		dst.clear();
+		mgrech::compact_into(dst, src, mgrech::compare_op::less, 2);
+		benchmark::DoNotOptimize(dst.data());
+	}
+}
+
+BENCHMARK(sum_ovector)        ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(sum_ovector_kernel) ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(sum_std_vector)     ->RangeMultiplier(32)->Range(1, 1024*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(sum_ovector_kernel_aligned)  ->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(sum_ovector_kernel_unaligned)->RangeMultiplier(32)->Range(1024, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(equal_ovector)      ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(equal_std_vector)   ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(find_ovector)       ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(find_std_vector)    ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(max_ovector)        ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(max_std_vector)     ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(compact_ovector)    ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(compact_std_vector) ->RangeMultiplier(32)->Range(1, 32*1024*1024)->Unit(benchmark::kMicrosecond);
 BENCHMARK_MAIN();
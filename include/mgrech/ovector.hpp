@@ -15,7 +15,13 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <new>
 #include <type_traits>
 
@@ -25,38 +31,197 @@
 #  define OVECTOR_NODISCARD
 #endif
 
+#if __cplusplus >= 201700 && defined(__has_include)
+#  if __has_include(<memory_resource>)
+#    include <exception>
+#    include <memory_resource>
+#    define OVECTOR_MEMORY_RESOURCE
+#  endif
+#endif
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine) && defined(__has_include)
+#  if __has_include(<coroutine>)
+#    include <coroutine>
+#    define OVECTOR_COROUTINES
+#  endif
+#endif
+
 #ifdef _MSC_VER
 #  define OVECTOR_FORCE_INLINE __forceinline
 #else
 #  define OVECTOR_FORCE_INLINE __attribute__((always_inline))
 #endif
 
-namespace mgrech { namespace detail
+namespace mgrech
+{
+
+namespace detail
+{
+
+// let's not include an unnecessary header just for size_t
+using size_type = decltype(sizeof 0);
+
+// granularity of the functions working on the pages of an allocation
+constexpr size_type page_size = 4096;
+
+} // namespace detail
+
+/**
+ * How an @c ovector tracks the pages modified between calls to @c ovector::collect_dirty_ranges.
+ */
+enum class dirty_tracking
+{
+	/** No tracking, every call reports all elements. */
+	none,
+	/**
+	 * userfaultfd write-protection, available on Linux 6.7 and later. Does not affect system calls writing to the
+	 * storage. Falls back to @c none where it is not available, use @c mprotect explicitly to track pages there.
+	 */
+	automatic,
+	/**
+	 * Write-protect the pages with mprotect and record the first write to each page in a SIGSEGV handler.
+	 * System calls writing to protected pages fail with @c EFAULT instead of faulting, so the ovector must not be
+	 * passed directly to functions like @c read.
+	 */
+	mprotect,
+};
+
+/**
+ * NUMA memory policy for the pages of an @c ovector. Only applied on Linux, and ignored if the kernel does not
+ * support NUMA policies.
+ */
+enum class numa_policy
+{
+	/** Keep the policy of the thread that first touches a page, by default its local node. */
+	inherit,
+	/** Allocate pages on the node of the thread that first touches them, regardless of the thread policy. */
+	local,
+	/** Spread pages round-robin over the selected nodes. */
+	interleave,
+	/** Allocate pages only on the selected nodes. */
+	bind,
+};
+
+/**
+ * Expected access pattern for the storage of an @c ovector, passed to @c ovector::advise.
+ */
+enum class access_hint
+{
+	/** No particular pattern, undoes the other hints. */
+	normal,
+	/** Sequential access: read ahead aggressively and reclaim pages soon after they were accessed. */
+	sequential,
+	/** Random access: do not read ahead. */
+	random,
+	/** The pages will be accessed soon: start reading them in if they were swapped out. */
+	will_need,
+};
+
+/**
+ * What the child process of a @c fork sees of the storage of an @c ovector. Only applied on Linux, and ignored
+ * together with @c ovector_options::snapshots.
+ * @details With a policy other than @c inherit, @c fork does not copy the page tables of the storage and neither
+ * process takes copy-on-write faults on it afterwards. In the child, the storage reads as zero bytes, but the
+ * @c ovector keeps its size, so its elements are generally no valid objects there. Call
+ * @c ovector::reset_after_fork in the child before using the @c ovector again. Other containers must only be
+ * destroyed in the child.
+ */
+enum class fork_policy
+{
+	/** The child gets a copy of the elements, shared copy-on-write with the parent. */
+	inherit,
+	/** The storage is not mapped into the child. The child gets fresh memory in its place after the fork. */
+	dont_fork,
+	/** The storage is mapped into the child but reads as zero there. Falls back to @c dont_fork before Linux 4.14. */
+	wipe_on_fork,
+};
+
+/**
+ * Options for the backing storage of an @c ovector, passed to @c ovector::with_max_size_or_null.
+ */
+struct ovector_options
+{
+	/**
+	 * Back the storage by an anonymous memory file (Linux @c memfd) instead of anonymous memory, which enables
+	 * @c ovector::snapshot. Ignored on other platforms.
+	 */
+	bool snapshots;
+
+	/**
+	 * Track modified pages for @c ovector::collect_dirty_ranges. Not available on Windows and together with
+	 * @c snapshots, in which case every call reports all elements.
+	 * @warning With @c dirty_tracking::mprotect system calls like @c read or @c recv fail with @c EFAULT when
+	 * they write into the storage, and a SIGSEGV handler is installed, see @c dirty_tracking.
+	 */
+	dirty_tracking track_dirty_pages;
+
+	/**
+	 * Alignment of the start of the storage in bytes, a power of two, e.g. 64 for a cache line, 4096 for a page
+	 * or 2 MiB for a huge page. 0 aligns to the element type only.
+	 * @details The storage ends right before a guard page, so that accessing the element past @c max_size faults.
+	 * The end of the storage is aligned to the element type only, so aligning the start moves the storage back by
+	 * up to @code alignment - 1 @endcode bytes, and by up to a page minus one byte for alignments of a page or
+	 * more. Writes to these bytes do not fault. The bytes are filled with a canary instead, which is checked when
+	 * the storage is released, and the program is terminated if it was overwritten.
+	 */
+	detail::size_type alignment;
+
+	/**
+	 * NUMA policy for the whole storage. See also @c ovector::set_numa_policy.
+	 */
+	numa_policy placement;
+
+	/**
+	 * Nodes for @c numa_policy::interleave and @c numa_policy::bind, bit @c i selects node @c i. 0 selects all
+	 * nodes.
+	 */
+	std::uint64_t placement_nodes;
+
+	/**
+	 * Let @c ovector::demote_cold_prefix mark the pages more than this many pages behind the last element as cold,
+	 * see @c ovector::mark_cold. 0 disables demotion. Only supported on Linux 5.4 and later.
+	 * @details Meant for append-only logs where only the newest part is accessed. Demotion happens in batches of
+	 * a quarter of the distance, so calling @c demote_cold_prefix often costs one system call per batch.
+	 */
+	detail::size_type demote_behind_pages;
+
+	/**
+	 * What the child process of a @c fork sees of the storage, see @c fork_policy.
+	 */
+	fork_policy on_fork;
+
+	ovector_options() noexcept
+		: snapshots(false), track_dirty_pages(dirty_tracking::none), alignment(0),
+		  placement(numa_policy::inherit), placement_nodes(0), demote_behind_pages(0), on_fork(fork_policy::inherit)
+	{}
+};
+
+namespace detail
 {
 
 template <typename T>
-OVECTOR_FORCE_INLINE
-auto inlined_move(T& value) noexcept
+inline OVECTOR_FORCE_INLINE
+T&& inlined_move(T& value) noexcept
 {
 	return static_cast<T&&>(value);
 }
 
 template <typename T>
-OVECTOR_FORCE_INLINE
-auto inlined_forward(typename std::remove_reference<T>::type& value) noexcept
+inline OVECTOR_FORCE_INLINE
+T&& inlined_forward(typename std::remove_reference<T>::type& value) noexcept
 {
-	return value;
+	return static_cast<T&&>(value);
 }
 
 template <typename T>
-OVECTOR_FORCE_INLINE
-auto inlined_forward(typename std::remove_reference<T>::type&& value) noexcept
+inline OVECTOR_FORCE_INLINE
+T&& inlined_forward(typename std::remove_reference<T>::type&& value) noexcept
 {
-	return inlined_move(value);
+	return static_cast<T&&>(value);
 }
 
 template <typename T, typename U>
-OVECTOR_FORCE_INLINE
+inline OVECTOR_FORCE_INLINE
 T inlined_exchange(T& ref, U&& value) noexcept
 {
 	T tmp = inlined_move(ref);
@@ -65,7 +230,7 @@ T inlined_exchange(T& ref, U&& value) noexcept
 }
 
 template <typename T>
-OVECTOR_FORCE_INLINE
+inline OVECTOR_FORCE_INLINE
 void inlined_swap(T& lhs, T& rhs) noexcept
 {
 	static_assert(std::is_nothrow_move_assignable<T>::value && std::is_nothrow_move_constructible<T>::value,
@@ -76,12 +241,107 @@ void inlined_swap(T& lhs, T& rhs) noexcept
 	rhs = inlined_move(tmp);
 }
 
-// let's not include an unnecessary header just for size_t
-using size_type = decltype(sizeof 0);
-
-void* guarded_alloc(size_type dataSize, size_type guardSize);
+void* guarded_alloc(size_type dataSize, size_type guardSize, ovector_options const& options);
 void guarded_dealloc(void* memory, size_type dataSize, size_type guardSize);
 
+// maps a read-only copy of the first usedSize bytes of an allocation made with ovector_options::snapshots.
+// returns nullptr if the allocation does not support snapshots or mapping failed.
+void const* guarded_snapshot(void* memory, size_type dataSize, size_type usedSize);
+void snapshot_dealloc(void const* snapshot, size_type dataSize, size_type usedSize);
+
+// applies a numa policy to the pages holding the bytes [first, last) of an allocation, relative to memory.
+// returns false if numa policies are not supported.
+bool guarded_place(void* memory, size_type first, size_type last, numa_policy policy, std::uint64_t nodes);
+
+// access_hint followed by the advice only used internally
+enum class page_advice
+{
+	normal,
+	sequential,
+	random,
+	will_need,
+	cold,
+	pageout,
+	// no transparent huge pages, so memory is committed per page
+	small_pages,
+};
+
+// zeroes the bytes [first, last) of an allocation, relative to memory, by returning the whole pages among them to
+// the os and clearing the rest
+void guarded_zero(void* memory, size_type first, size_type last);
+
+// returns the pages that hold no byte at or after last to the os, given that those before first were returned
+// before. their contents are zero afterwards, but they stay usable.
+void guarded_release_front(void* memory, size_type first, size_type last);
+
+// applies advice to the pages holding the bytes [first, last) of an allocation, relative to memory. hints apply
+// to all pages touched by the range, cold and pageout only to pages entirely within it. returns false if the
+// advice is not supported.
+bool guarded_advise(void* memory, size_type dataSize, size_type first, size_type last, page_advice advice);
+
+// marks the pages of an allocation made with ovector_options::demote_behind_pages cold up to the configured
+// distance behind the last used byte. returns false if demotion is off for the allocation.
+bool guarded_demote(void* memory, size_type usedSize);
+
+// returns the pages holding the first usedSize bytes of an allocation to the os. their contents are unspecified
+// afterwards, but they stay usable.
+void guarded_discard(void* memory, size_type dataSize, size_type usedSize);
+
+// reports the byte ranges [first, last) of the first usedSize bytes of an allocation that were modified since the
+// previous call, relative to memory and in ascending order. reports everything if the allocation is not tracked.
+using dirty_range_callback = void (*)(void* context, size_type first, size_type last);
+void guarded_collect_dirty(void* memory, size_type dataSize, size_type usedSize, dirty_range_callback callback,
+                           void* context);
+
+// move n objects from src to dst by copying their bytes, the ranges may overlap
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+void relocate(T* dst, T const* src, size_type n) noexcept
+{
+	std::memmove((void*)dst, (void const*)src, n * sizeof(T));
+}
+
+// gap opened by insert for the new elements, closed again if constructing them throws
+template <typename T>
+struct insert_gap
+{
+	T* pos;
+	size_type n;
+	size_type tail;
+	size_type constructed;
+
+	OVECTOR_FORCE_INLINE
+	~insert_gap() noexcept
+	{
+		if(constructed == n)
+			return;
+
+		for(size_type i = 0; i != constructed; ++i)
+			pos[i].~T();
+
+		relocate(pos, pos + n, tail);
+	}
+};
+
+// state of an in-place compaction: [0, write) is compacted, [write, read) is a hole, [read, size) is untouched.
+// the destructor closes the hole, which also happens if the predicate throws.
+template <typename T>
+struct compaction
+{
+	T* memory;
+	size_type* size;
+	size_type read;
+	size_type write;
+
+	OVECTOR_FORCE_INLINE
+	~compaction() noexcept
+	{
+		auto s = *size;
+		relocate(memory + write, memory + read, s - read);
+		*size = write + (s - read);
+	}
+};
+
 // RAII-style wrapper for the backing storage
 template <typename T>
 struct ovector_storage
@@ -99,8 +359,8 @@ struct ovector_storage
 	{}
 
 	OVECTOR_FORCE_INLINE
-	explicit ovector_storage(size_type max_size) noexcept
-		: memory((T*)guarded_alloc(max_size * sizeof(T), sizeof(T))),
+	ovector_storage(size_type max_size, ovector_options const& options) noexcept
+		: memory((T*)guarded_alloc(max_size * sizeof(T), sizeof(T), options)),
 		  size(0), max_size(memory ? max_size : 0)
 	{}
 
@@ -138,6 +398,21 @@ private:
 
 } // namespace detail
 
+template <typename T>
+class ovector_snapshot;
+
+/**
+ * Trait that indicates whether objects of type @c T can be moved to a different address by copying their bytes,
+ * without invoking the move constructor at the destination or the destructor at the source.
+ * @details Defaults to @c std::is_trivially_copyable. May be specialized to @c std::true_type for types that are
+ * safe to relocate but not trivially copyable, e.g. types that own a heap allocation through a pointer.
+ * The invalidating operations of @c ovector (@c insert, @c erase, @c erase_if, @c swap_remove) use this trait to
+ * shift elements with a single @c memmove.
+ */
+template <typename T>
+struct is_trivially_relocatable : std::integral_constant<bool, std::is_trivially_copyable<T>::value>
+{};
+
 /**
  * @brief overcommit vector
  * @tparam T element type, should be nothrow-destructible
@@ -158,10 +433,12 @@ template <typename T>
 class ovector
 {
 	detail::ovector_storage<T> _storage;
+	// index of the first element, see trim_front
+	detail::size_type _first = 0;
 
 	OVECTOR_FORCE_INLINE
-	explicit ovector(detail::size_type max_size) noexcept
-		: _storage(max_size)
+	ovector(detail::size_type max_size, ovector_options const& options) noexcept
+		: _storage(max_size, options)
 	{}
 
 	OVECTOR_FORCE_INLINE
@@ -174,6 +451,7 @@ class ovector
 	void clear_impl(std::true_type) noexcept
 	{
 		_storage.size = 0;
+		_first = 0;
 	}
 
 	void clear_impl(std::false_type) noexcept
@@ -188,11 +466,184 @@ class ovector
 		{
 			auto s = _storage.size;
 
-			for(size_type i = 0; i != s; ++i)
+			for(size_type i = _first; i != s; ++i)
 				p[i].~T();
 
 			_storage.size = 0;
+			_first = 0;
+		}
+	}
+
+	OVECTOR_FORCE_INLINE
+	void destroy_impl(T* first, T* last, std::true_type) noexcept
+	{
+		(void)first;
+		(void)last;
+	}
+
+	void destroy_impl(T* first, T* last, std::false_type) noexcept
+	{
+		for(; first != last; ++first)
+			first->~T();
+	}
+
+	using relocatable_tag = std::integral_constant<bool, is_trivially_relocatable<T>::value>;
+
+	OVECTOR_FORCE_INLINE
+	void erase_impl(T* first, T* last, std::true_type) noexcept
+	{
+		auto p = _storage.memory;
+		auto s = _storage.size;
+
+		for(auto it = first; it != last; ++it)
+			it->~T();
+
+		detail::relocate(first, last, (size_type)(p + s - last));
+		_storage.size = s - (size_type)(last - first);
+	}
+
+	OVECTOR_FORCE_INLINE
+	void erase_impl(T* first, T* last, std::false_type) noexcept(std::is_nothrow_move_assignable<T>::value)
+	{
+		auto end = _storage.memory + _storage.size;
+		auto dst = first;
+
+		for(auto src = last; src != end; ++src, ++dst)
+			*dst = detail::inlined_move(*src);
+
+		for(auto it = dst; it != end; ++it)
+			it->~T();
+
+		_storage.size -= (size_type)(last - first);
+	}
+
+	template <typename It>
+	OVECTOR_FORCE_INLINE
+	void insert_impl(T* pos, It first, It last, detail::size_type n, std::true_type)
+	{
+		auto tail = (size_type)(_storage.memory + _storage.size - pos);
+		detail::relocate(pos + n, pos, tail);
+
+		// if a constructor throws, the gap destroys the new elements and moves the tail back
+		detail::insert_gap<T> gap = {pos, n, tail, 0};
+
+		for(; first != last; ++first, ++gap.constructed)
+			new(pos + gap.constructed) T(*first);
+
+		_storage.size += n;
+	}
+
+	template <typename It>
+	OVECTOR_FORCE_INLINE
+	void insert_impl(T* pos, It first, It last, detail::size_type n, std::false_type)
+	{
+		(void)n;
+
+		auto p = _storage.memory;
+		auto offset = pos - p;
+		auto oldSize = _storage.size;
+
+		for(; first != last; ++first)
+			emplace_back(*first);
+
+		std::rotate(p + offset, p + oldSize, p + _storage.size);
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap_remove_impl(detail::size_type index, std::true_type) noexcept
+	{
+		auto p = _storage.memory;
+		auto last = _storage.size - 1;
+
+		// branch-free: relocating the last element onto itself is a no-op
+		p[index].~T();
+		detail::relocate(p + index, p + last, 1);
+		_storage.size = last;
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap_remove_impl(detail::size_type index, std::false_type) noexcept(std::is_nothrow_move_assignable<T>::value)
+	{
+		auto p = _storage.memory;
+		auto last = _storage.size - 1;
+
+		if(index != last)
+			p[index] = detail::inlined_move(p[last]);
+
+		pop_back();
+	}
+
+	template <typename Pred>
+	OVECTOR_FORCE_INLINE
+	detail::size_type erase_if_impl(Pred& pred, std::true_type)
+	{
+		auto p = _storage.memory;
+		auto s = _storage.size;
+		detail::compaction<T> c = {p, &_storage.size, _first, _first};
+
+		// kept elements are not moved one by one, instead each run of them is relocated once
+		// the next element to be removed is found
+		for(size_type i = _first; i != s; ++i)
+		{
+			if(pred(p[i]))
+			{
+				if(c.write != c.read)
+					detail::relocate(p + c.write, p + c.read, i - c.read);
+
+				c.write += i - c.read;
+				p[i].~T();
+				c.read = i + 1;
+			}
 		}
+
+		// the compaction moves the last run into place when it goes out of scope
+		return c.read - c.write;
+	}
+
+	template <typename Pred>
+	OVECTOR_FORCE_INLINE
+	detail::size_type erase_if_impl(Pred& pred, std::false_type)
+	{
+		auto p = _storage.memory + _first;
+		auto end = _storage.memory + _storage.size;
+		auto dst = p;
+
+		for(auto src = p; src != end; ++src)
+		{
+			if(!pred(*src))
+			{
+				if(dst != src)
+					*dst = detail::inlined_move(*src);
+
+				++dst;
+			}
+		}
+
+		for(auto it = dst; it != end; ++it)
+			it->~T();
+
+		auto removed = (size_type)(end - dst);
+		_storage.size -= removed;
+		return removed;
+	}
+
+	template <typename F>
+	struct dirty_range_context
+	{
+		F* callback;
+		detail::size_type first;
+	};
+
+	// converts the byte ranges reported by guarded_collect_dirty to element indices, dropping trimmed elements
+	template <typename F>
+	static void dirty_range_thunk(void* context, detail::size_type first, detail::size_type last)
+	{
+		auto c = (dirty_range_context<F>*)context;
+		first /= sizeof(T);
+		last = (last + sizeof(T) - 1) / sizeof(T);
+
+		if(last > c->first)
+			(*c->callback)(first > c->first ? first : c->first, last);
 	}
 
 public:
@@ -226,13 +677,18 @@ public:
 	 * Construct an @c ovector from another by moving its contents. After this operation the moved-from @c ovector
 	 * is not backed by storage.
 	 */
-	ovector(ovector&&) noexcept = default;
+	OVECTOR_FORCE_INLINE
+	ovector(ovector&& other) noexcept
+		: _storage(detail::inlined_move(other._storage)),
+		  _first(detail::inlined_exchange(other._first, 0))
+	{}
 
 	OVECTOR_FORCE_INLINE
 	ovector& operator=(ovector&& other) noexcept
 	{
 		clear();
 		_storage = detail::inlined_move(other._storage);
+		_first = detail::inlined_exchange(other._first, 0);
 		return *this;
 	}
 
@@ -246,7 +702,21 @@ public:
 	static
 	ovector with_max_size_or_null(size_type max_size) noexcept
 	{
-		return ovector(max_size);
+		return ovector(max_size, ovector_options());
+	}
+
+	/**
+	 * Create a new @c ovector with given capacity and storage options.
+	 * @param max_size The number of elements that the @c ovector should have storage capacity for.
+	 * @param options Options for the backing storage.
+	 * @return The newly created @c ovector. @c data() returns @c nullptr if the allocation failed.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	static
+	ovector with_max_size_or_null(size_type max_size, ovector_options const& options) noexcept
+	{
+		return ovector(max_size, options);
 	}
 
 	OVECTOR_FORCE_INLINE
@@ -283,7 +753,8 @@ public:
 
 	/**
 	 * Get number of elements.
-	 * @return The number of elements currently held by this @c ovector.
+	 * @return The number of elements currently held by this @c ovector, including those removed by
+	 * @c trim_front. This is the index one past the last element.
 	 */
 	OVECTOR_NODISCARD
 	OVECTOR_FORCE_INLINE
@@ -300,7 +771,19 @@ public:
 	OVECTOR_FORCE_INLINE
 	bool empty() const noexcept
 	{
-		return size() == 0;
+		return size() == first_index();
+	}
+
+	/**
+	 * Get the index of the first element.
+	 * @return The number of elements removed by @c trim_front since the last @c clear, 0 if none were removed.
+	 * The elements have the indices [first_index(), size()).
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type first_index() const noexcept
+	{
+		return _first;
 	}
 
 	/**
@@ -319,7 +802,7 @@ public:
 	OVECTOR_FORCE_INLINE
 	T* begin() noexcept
 	{
-		return data();
+		return data() + first_index();
 	}
 
 	OVECTOR_NODISCARD
@@ -361,7 +844,7 @@ public:
 	OVECTOR_FORCE_INLINE
 	T& operator[](size_type index) noexcept
 	{
-		assert(index < _storage.size);
+		assert(index >= _first && index < _storage.size);
 		return data()[index];
 	}
 
@@ -376,7 +859,7 @@ public:
 	OVECTOR_FORCE_INLINE
 	T& front() noexcept
 	{
-		return *_storage.memory;
+		return _storage.memory[_first];
 	}
 
 	OVECTOR_NODISCARD
@@ -444,7 +927,7 @@ public:
 
 	/**
 	 * Remove the last element and invoke its destructor.
-	 * @pre @code size() != 0 @endcode
+	 * @pre @code !empty() @endcode
 	 * @post new_size = old_size - 1
 	 */
 	OVECTOR_FORCE_INLINE
@@ -455,7 +938,7 @@ public:
 
 	/**
 	 * Remove all elements.
-	 * @post @code size() == 0 @endcode
+	 * @post @code size() == 0 && first_index() == 0 @endcode
 	 * @note Complexity: O(1) if T is trivially destructible, O(n) otherwise.
 	 */
 	OVECTOR_FORCE_INLINE
@@ -467,6 +950,20 @@ public:
 		clear_impl(std::integral_constant<bool, std::is_trivially_destructible<T>::value>());
 	}
 
+	/**
+	 * Remove all elements without destroying them. Meant for the child process of a @c fork, where the storage of an
+	 * @c ovector created with a @c fork_policy other than @c inherit reads as zero bytes, so that it can be used
+	 * again.
+	 * @post @code size() == 0 && first_index() == 0 @endcode
+	 * @note Complexity: O(1).
+	 */
+	OVECTOR_FORCE_INLINE
+	void reset_after_fork() noexcept
+	{
+		_storage.size = 0;
+		_first = 0;
+	}
+
 	/**
 	 * Grow at back without constructing elements.
 	 * @param n Number of elements to grow by.
@@ -486,7 +983,7 @@ public:
 	 * Shrink at back without calling destructors.
 	 * @param n Number of elements to shrink by.
 	 * @return A pointer to the storage previously occupied by the elements.
-	 * @pre @code size() >= n @endcode
+	 * @pre @code size() - first_index() >= n @endcode
 	 * @post @code new_size = old_size - n @endcode
 	 * @note Complexity: O(1).
 	 */
@@ -497,35 +994,2547 @@ public:
 		return _storage.memory + _storage.size;
 	}
 
+	/**
+	 * Remove the elements in the range [first, last) and shift the following elements down to close the gap.
+	 * @return A pointer to the element that followed the last removed element.
+	 * @pre [first, last) is a valid range of elements of this @c ovector.
+	 * @post @code new_size = old_size - (last - first) @endcode
+	 * @note Complexity: O(n) in the number of elements after @p last. If @c is_trivially_relocatable<T> holds,
+	 * the elements are shifted with a single @c memmove, otherwise they are move-assigned one by one.
+	 * @warning Invalidates pointers to elements at or after @p first.
+	 */
 	OVECTOR_FORCE_INLINE
-	void swap(ovector& other) noexcept
+	T* erase(T const* first, T const* last)
+		noexcept(is_trivially_relocatable<T>::value || std::is_nothrow_move_assignable<T>::value)
 	{
-		detail::inlined_swap(_storage.memory, other._storage.memory);
-		detail::inlined_swap(_storage.size, other._storage.size);
-		detail::inlined_swap(_storage.max_size, other._storage.max_size);
+		auto f = const_cast<T*>(first);
+		erase_impl(f, const_cast<T*>(last), relocatable_tag());
+		return f;
 	}
-};
 
-template <typename T>
-OVECTOR_FORCE_INLINE
-void swap(ovector<T>& lhs, ovector<T>& rhs) noexcept
-{
-	lhs.swap(rhs);
-}
+	/**
+	 * Remove the element at @p pos.
+	 * @see @c erase(T const*, T const*)
+	 */
+	OVECTOR_FORCE_INLINE
+	T* erase(T const* pos)
+		noexcept(is_trivially_relocatable<T>::value || std::is_nothrow_move_assignable<T>::value)
+	{
+		return erase(pos, pos + 1);
+	}
 
-template <typename T>
-OVECTOR_NODISCARD
-bool operator==(ovector<T> const& lhs, ovector<T> const& rhs) noexcept
-{
-	return lhs.size() == rhs.size() && std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin());
-}
+	/**
+	 * Insert copies of the elements in the range [first, last) before @p pos.
+	 * @tparam It forward iterator type, @c T must be constructible from its reference type.
+	 * @return A pointer to the first inserted element.
+	 * @throw Any exception thrown by the constructor.
+	 * @pre @p pos is a pointer into [begin(), end()].
+	 * @pre [first, last) does not refer to elements of this @c ovector.
+	 * @pre @code size() + std::distance(first, last) &lt;= max_size() @endcode
+	 * @post @code new_size = old_size + std::distance(first, last) @endcode
+	 * @note Complexity: O(n) in the number of inserted elements plus the number of elements after @p pos.
+	 * If @c is_trivially_relocatable<T> holds, the elements after @p pos are shifted with a single @c memmove
+	 * and the strong exception guarantee is provided. Otherwise the new elements are appended and rotated into
+	 * place, which provides the basic exception guarantee.
+	 * @warning Invalidates pointers to elements at or after @p pos.
+	 */
+	template <typename It>
+	OVECTOR_FORCE_INLINE
+	T* insert(T const* pos, It first, It last)
+	{
+		auto p = const_cast<T*>(pos);
+		insert_impl(p, first, last, (size_type)std::distance(first, last), relocatable_tag());
+		return p;
+	}
 
-template <typename T>
-OVECTOR_NODISCARD
-OVECTOR_FORCE_INLINE
-bool operator!=(ovector<T> const& lhs, ovector<T> const& rhs) noexcept
+	/**
+	 * Remove the element at @p index by replacing it with the last element.
+	 * @pre @code index >= first_index() && index &lt; size() @endcode
+	 * @post @code new_size = old_size - 1 @endcode
+	 * @note Complexity: O(1). The order of the remaining elements is not preserved.
+	 * @warning Invalidates pointers to the element at @p index and to the last element.
+	 */
+	OVECTOR_FORCE_INLINE
+	void swap_remove(size_type index)
+		noexcept(is_trivially_relocatable<T>::value || std::is_nothrow_move_assignable<T>::value)
+	{
+		assert(index >= _first && index < _storage.size);
+		swap_remove_impl(index, relocatable_tag());
+	}
+
+	/**
+	 * Remove all elements for which @p pred returns @c true, preserving the order of the remaining elements.
+	 * @return The number of removed elements.
+	 * @throw Any exception thrown by @p pred.
+	 * @note Complexity: O(n). If @c is_trivially_relocatable<T> holds, every run of kept elements is shifted with
+	 * a single @c memmove, otherwise kept elements are move-assigned one by one.
+	 * @note If @p pred throws and @c is_trivially_relocatable<T> holds, the elements removed up to that point stay
+	 * removed and all other elements are kept. Otherwise the basic exception guarantee is provided.
+	 * @warning Invalidates pointers to all elements after the first removed element.
+	 */
+	template <typename Pred>
+	OVECTOR_FORCE_INLINE
+	size_type erase_if(Pred pred)
+	{
+		return erase_if_impl(pred, relocatable_tag());
+	}
+
+	/**
+	 * Remove the first @p n elements without moving the others, e.g. to keep a sliding window of a stream.
+	 * The storage pages that only held removed elements are returned to the operating system.
+	 * @pre @code size() - first_index() >= n @endcode
+	 * @post @code new_first_index = old_first_index + n @endcode
+	 * @post @c size() and the indices and addresses of the remaining elements are unchanged.
+	 * @note Complexity: O(n) if T is not trivially destructible, O(1) otherwise, plus a system call if a page
+	 * becomes free. The pages are released in place and the storage behind them stays reserved, so the
+	 * @c ovector still cannot grow beyond @c max_size. @c clear makes the whole storage usable again.
+	 * @note With @c ovector_options::snapshots the pages stay allocated in the backing file.
+	 */
+	void trim_front(size_type n) noexcept
+	{
+		assert(_storage.size - _first >= n);
+
+		if(n == 0)
+			return;
+
+		auto p = _storage.memory;
+		auto first = _first;
+		destroy_impl(p + first, p + first + n, std::is_trivially_destructible<T>());
+		_first = first + n;
+		detail::guarded_release_front(p, first * sizeof(T), _first * sizeof(T));
+	}
+
+	/**
+	 * Create a read-only point-in-time copy of the elements.
+	 * @return The snapshot. It is not backed by memory if this @c ovector was not created with
+	 * @c ovector_options::snapshots or if mapping the snapshot failed.
+	 * @pre No other thread accesses this @c ovector during the call.
+	 * @note Complexity: The first snapshot only remaps the storage and copies no data. Later snapshots walk the
+	 * page tables and copy the pages modified since the previous snapshot into the backing file, and each
+	 * snapshot still alive copies those of them it has not copied yet.
+	 * @note Pointers stay valid, but afterwards the storage is mapped copy-on-write, so the first write to each
+	 * page copies it.
+	 */
+	OVECTOR_NODISCARD
+	ovector_snapshot<T> snapshot() const noexcept
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable to be snapshotted");
+
+		auto memory = _storage.memory;
+
+		if(!memory)
+			return ovector_snapshot<T>();
+
+		auto dataSize = _storage.max_size * sizeof(T);
+		auto snapshot = detail::guarded_snapshot(memory, dataSize, _storage.size * sizeof(T));
+
+		if(!snapshot)
+			return ovector_snapshot<T>();
+
+		return ovector_snapshot<T>((T const*)snapshot, _storage.size, _storage.max_size);
+	}
+
+	/**
+	 * Report the elements modified since the previous call, or since creation on the first call.
+	 * @param callback Invoked as @c callback(first,last) for every range [first, last) of indices of possibly
+	 * modified elements, in ascending order.
+	 * @details Modifications are tracked per page, so the ranges are rounded out to page boundaries and then
+	 * clamped to [first_index(), size()). Everything appended since the previous call is reported as one range
+	 * without looking at the pages, only the part below this append watermark is checked for modifications. If the
+	 * @c ovector was not created with @c ovector_options::track_dirty_pages or tracking is not available, all
+	 * elements are reported.
+	 * @pre No other thread changes the size of this @c ovector during the call. Other threads may modify elements,
+	 * modifications that race with the call are reported by this or the next call.
+	 * @note Complexity: O(pages below the watermark) for @c dirty_tracking::mprotect. With userfaultfd the kernel
+	 * walks the page tables and skips unpopulated regions.
+	 */
+	template <typename F>
+	void collect_dirty_ranges(F callback) const
+	{
+		auto memory = _storage.memory;
+
+		if(!memory)
+			return;
+
+		auto dataSize = _storage.max_size * sizeof(T);
+		dirty_range_context<F> context = {&callback, _first};
+		detail::guarded_collect_dirty(memory, dataSize, _storage.size * sizeof(T), &dirty_range_thunk<F>, &context);
+	}
+
+	/**
+	 * Apply a NUMA policy to the storage of the elements [first, last), which may extend beyond the size up to
+	 * @c max_size, e.g. to place the partition of the data owned by a thread near that thread.
+	 * @param nodes The nodes for @c numa_policy::interleave and @c numa_policy::bind, bit @c i selects node @c i.
+	 * 0 selects all nodes.
+	 * @return Whether the policy was applied. @c false if NUMA policies are not supported.
+	 * @pre @code first <= last && last <= max_size() @endcode
+	 * @note The policy applies to whole pages, so [first, last) is rounded out to page boundaries. Pages that were
+	 * already touched are migrated on a best-effort basis.
+	 */
+	bool set_numa_policy(size_type first, size_type last, numa_policy policy, std::uint64_t nodes = 0) noexcept
+	{
+		assert(first <= last && last <= max_size());
+
+		if(!_storage.memory || first == last)
+			return false;
+
+		return detail::guarded_place(_storage.memory, first * sizeof(T), last * sizeof(T), policy, nodes);
+	}
+
+	/**
+	 * Tell the operating system how the whole storage, up to @c max_size, will be accessed.
+	 * @return Whether the hint was applied. @c false if it is not supported.
+	 */
+	bool advise(access_hint hint) noexcept
+	{
+		return advise(0, max_size(), hint);
+	}
+
+	/**
+	 * Tell the operating system how the storage of the elements [first, last) will be accessed.
+	 * @return Whether the hint was applied. @c false if it is not supported.
+	 * @pre @code first <= last && last <= max_size() @endcode
+	 * @note The hint applies to whole pages, so [first, last) is rounded out to page boundaries.
+	 */
+	bool advise(size_type first, size_type last, access_hint hint) noexcept
+	{
+		assert(first <= last && last <= max_size());
+
+		if(!_storage.memory || first == last)
+			return false;
+
+		return detail::guarded_advise(_storage.memory, max_size() * sizeof(T), first * sizeof(T), last * sizeof(T),
+		                              (detail::page_advice)hint);
+	}
+
+	/**
+	 * Tell the operating system that the elements [first, last) will not be accessed for a while, so their pages
+	 * are reclaimed before others under memory pressure. The elements stay valid and in place, accessing them
+	 * later only costs a page fault if their pages were reclaimed.
+	 * @param pageout Reclaim the pages right away instead of only moving them to the front of the reclaim queue.
+	 * @return Whether the pages were marked. @c false if not supported, which needs Linux 5.4 or later.
+	 * @pre @code first <= last && last <= max_size() @endcode
+	 * @note Only pages entirely within [first, last) are marked.
+	 */
+	bool mark_cold(size_type first, size_type last, bool pageout = false) noexcept
+	{
+		assert(first <= last && last <= max_size());
+
+		if(!_storage.memory || first == last)
+			return false;
+
+		auto advice = pageout ? detail::page_advice::pageout : detail::page_advice::cold;
+		return detail::guarded_advise(_storage.memory, max_size() * sizeof(T), first * sizeof(T), last * sizeof(T),
+		                              advice);
+	}
+
+	/**
+	 * Mark the pages more than @c ovector_options::demote_behind_pages pages behind the last element as cold, see
+	 * @c mark_cold. Meant to be called periodically by the owner of an append-only log, e.g. after each batch of
+	 * appends; growing the @c ovector never demotes pages by itself.
+	 * @return Whether demotion is enabled for this @c ovector. @c false if it was created without
+	 * @c demote_behind_pages or demotion is not supported, which needs Linux 5.4 or later.
+	 * @note Pages are demoted in batches of a quarter of the distance, so most calls only cost a lookup. After the
+	 * @c ovector shrinks, e.g. by @c clear, call this once before it grows again so that the refilled pages are
+	 * demoted again.
+	 */
+	bool demote_cold_prefix() noexcept
+	{
+		return _storage.memory && detail::guarded_demote(_storage.memory, _storage.size * sizeof(T));
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap(ovector& other) noexcept
+	{
+		detail::inlined_swap(_storage.memory, other._storage.memory);
+		detail::inlined_swap(_storage.size, other._storage.size);
+		detail::inlined_swap(_storage.max_size, other._storage.max_size);
+		detail::inlined_swap(_first, other._first);
+	}
+};
+
+template <typename T>
+OVECTOR_FORCE_INLINE
+void swap(ovector<T>& lhs, ovector<T>& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+/**
+ * @brief read-only point-in-time copy of an @c ovector
+ * @details Created by @c ovector::snapshot. The snapshot shares the pages of the @c ovector it was taken from
+ * until the next snapshot of the @c ovector writes the pages modified in the meantime back, which copies them into
+ * this snapshot first. The size of a snapshot is fixed.
+ * A snapshot stays valid after the @c ovector it was taken from is destroyed.
+ */
+template <typename T>
+class ovector_snapshot
+{
+	friend class ovector<T>;
+
+	T const* _data;
+	detail::size_type _size;
+	detail::size_type _max_size;
+
+	OVECTOR_FORCE_INLINE
+	ovector_snapshot(T const* data, detail::size_type size, detail::size_type max_size) noexcept
+		: _data(data), _size(size), _max_size(max_size)
+	{}
+
+	OVECTOR_FORCE_INLINE
+	void deallocate() noexcept
+	{
+		if(_data)
+			detail::snapshot_dealloc(_data, _max_size * sizeof(T), _size * sizeof(T));
+	}
+
+public:
+	using value_type = T;
+	using const_reference = T const&;
+	using const_iterator = T const*;
+	using size_type = detail::size_type;
+
+	ovector_snapshot(ovector_snapshot const&) = delete;
+	ovector_snapshot& operator=(ovector_snapshot const&) = delete;
+
+	/**
+	 * Construct a snapshot without backing memory.
+	 * @post @code data() == nullptr @endcode
+	 * @post @code size() == 0 @endcode
+	 */
+	OVECTOR_FORCE_INLINE
+	ovector_snapshot() noexcept
+		: _data(nullptr), _size(0), _max_size(0)
+	{}
+
+	OVECTOR_FORCE_INLINE
+	ovector_snapshot(ovector_snapshot&& other) noexcept
+		: _data(detail::inlined_exchange(other._data, nullptr)),
+		  _size(detail::inlined_exchange(other._size, 0)),
+		  _max_size(detail::inlined_exchange(other._max_size, 0))
+	{}
+
+	OVECTOR_FORCE_INLINE
+	ovector_snapshot& operator=(ovector_snapshot&& other) noexcept
+	{
+		deallocate();
+		_data = detail::inlined_exchange(other._data, nullptr);
+		_size = detail::inlined_exchange(other._size, 0);
+		_max_size = detail::inlined_exchange(other._max_size, 0);
+		return *this;
+	}
+
+	OVECTOR_FORCE_INLINE
+	~ovector_snapshot() noexcept
+	{
+		deallocate();
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return _data != nullptr;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const* data() const noexcept
+	{
+		return _data;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type size() const noexcept
+	{
+		return _size;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool empty() const noexcept
+	{
+		return _size == 0;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const* begin() const noexcept
+	{
+		return _data;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const* end() const noexcept
+	{
+		return _data + _size;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const& operator[](size_type index) const noexcept
+	{
+		assert(index < _size);
+		return _data[index];
+	}
+};
+
+/**
+ * Comparison used by @c compact_into to select elements.
+ */
+enum class compare_op
+{
+	equal,
+	not_equal,
+	less,
+	less_equal,
+	greater,
+	greater_equal,
+};
+
+namespace detail
+{
+
+// element types with vectorized kernels, see ovector.cpp
+enum class kernel_type
+{
+	none,
+	i32,
+	u32,
+	i64,
+	u64,
+	f32,
+	f64,
+};
+
+template <typename T>
+struct kernel_type_of : std::integral_constant<kernel_type,
+	std::is_integral<T>::value && !std::is_same<T, bool>::value
+		? (sizeof(T) == 4 ? (std::is_signed<T>::value ? kernel_type::i32 : kernel_type::u32)
+		:  sizeof(T) == 8 ? (std::is_signed<T>::value ? kernel_type::i64 : kernel_type::u64)
+		:  kernel_type::none)
+	: std::is_same<T, float>::value  ? kernel_type::f32
+	: std::is_same<T, double>::value ? kernel_type::f64
+	: kernel_type::none>
+{};
+
+template <typename T>
+using has_kernels = std::integral_constant<bool, kernel_type_of<T>::value != kernel_type::none>;
+
+// equality of the object representation implies equality of the values and vice versa
+template <typename T>
+using is_bitwise_comparable = std::integral_constant<bool,
+	std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>;
+
+template <typename T>
+struct sum_type
+{
+	using type = typename std::conditional<std::is_integral<T>::value,
+		typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type,
+		T>::type;
+};
+
+// instruction set extensions the kernels are compiled for, in order of preference
+enum class kernel_isa
+{
+	scalar,
+	sse42,
+	avx2,
+};
+
+// elements are passed type-erased, the table determines the element type
+struct kernel_table
+{
+	size_type (*find)(void const* data, size_type size, void const* value);
+	size_type (*count)(void const* data, size_type size, void const* value);
+	void (*sum)(void const* data, size_type size, void* result);
+	void (*minimum)(void const* data, size_type size, void* result);
+	void (*maximum)(void const* data, size_type size, void* result);
+	size_type (*compact)(void* dst, size_type capacity, void const* src, size_type size, compare_op op, void const* value);
+};
+
+// best instruction set supported by both the build and the cpu, detected once via cpuid
+kernel_isa detect_kernel_isa() noexcept;
+
+// @pre isa <= detect_kernel_isa()
+kernel_table const& kernels(kernel_type type, kernel_isa isa) noexcept;
+
+inline OVECTOR_FORCE_INLINE
+kernel_table const& kernels(kernel_type type) noexcept
+{
+	static kernel_isa const isa = detect_kernel_isa();
+	return kernels(type, isa);
+}
+
+// counts the set bits in n words
+using popcount_kernel = size_type (*)(std::uint64_t const* words, size_type n);
+
+// @pre isa <= detect_kernel_isa()
+popcount_kernel popcount_kernel_for(kernel_isa isa) noexcept;
+
+inline OVECTOR_FORCE_INLINE
+popcount_kernel popcount_kernel_for() noexcept
+{
+	static popcount_kernel const kernel = popcount_kernel_for(detect_kernel_isa());
+	return kernel;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+bool compare(T const& lhs, compare_op op, T const& rhs)
+{
+	switch(op)
+	{
+	case compare_op::equal:         return lhs == rhs;
+	case compare_op::not_equal:     return lhs != rhs;
+	case compare_op::less:          return lhs < rhs;
+	case compare_op::less_equal:    return lhs <= rhs;
+	case compare_op::greater:       return lhs > rhs;
+	case compare_op::greater_equal: return lhs >= rhs;
+	}
+
+	return false;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+bool equal(T const* lhs, T const* rhs, size_type size, std::true_type) noexcept
+{
+	// memcmp must not be passed null pointers, even for a size of 0
+	return size == 0 || std::memcmp(lhs, rhs, size * sizeof(T)) == 0;
+}
+
+template <typename T>
+bool equal(T const* lhs, T const* rhs, size_type size, std::false_type)
+{
+	for(size_type i = 0; i != size; ++i)
+		if(!(lhs[i] == rhs[i]))
+			return false;
+
+	return true;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+size_type find(T const* data, size_type size, T const& value, std::true_type) noexcept
+{
+	return kernels(kernel_type_of<T>::value).find(data, size, &value);
+}
+
+template <typename T>
+size_type find(T const* data, size_type size, T const& value, std::false_type)
+{
+	for(size_type i = 0; i != size; ++i)
+		if(data[i] == value)
+			return i;
+
+	return size;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+size_type count(T const* data, size_type size, T const& value, std::true_type) noexcept
+{
+	return kernels(kernel_type_of<T>::value).count(data, size, &value);
+}
+
+template <typename T>
+size_type count(T const* data, size_type size, T const& value, std::false_type)
+{
+	size_type n = 0;
+
+	for(size_type i = 0; i != size; ++i)
+		n += data[i] == value;
+
+	return n;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+typename sum_type<T>::type sum(T const* data, size_type size, std::true_type) noexcept
+{
+	typename sum_type<T>::type result;
+	kernels(kernel_type_of<T>::value).sum(data, size, &result);
+	return result;
+}
+
+template <typename T>
+typename sum_type<T>::type sum(T const* data, size_type size, std::false_type)
+{
+	typename sum_type<T>::type result = typename sum_type<T>::type();
+
+	for(size_type i = 0; i != size; ++i)
+		result += data[i];
+
+	return result;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+T min_value(T const* data, size_type size, std::true_type) noexcept
+{
+	T result;
+	kernels(kernel_type_of<T>::value).minimum(data, size, &result);
+	return result;
+}
+
+template <typename T>
+T min_value(T const* data, size_type size, std::false_type)
+{
+	auto p = data;
+
+	for(size_type i = 1; i != size; ++i)
+		if(data[i] < *p)
+			p = data + i;
+
+	return *p;
+}
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+T max_value(T const* data, size_type size, std::true_type) noexcept
+{
+	T result;
+	kernels(kernel_type_of<T>::value).maximum(data, size, &result);
+	return result;
+}
+
+template <typename T>
+T max_value(T const* data, size_type size, std::false_type)
+{
+	auto p = data;
+
+	for(size_type i = 1; i != size; ++i)
+		if(*p < data[i])
+			p = data + i;
+
+	return *p;
+}
+
+} // namespace detail
+
+/**
+ * Compare two @c ovector objects element by element.
+ * @note For integral, enum and pointer types the comparison is done with a single @c memcmp.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+bool operator==(ovector<T> const& lhs, ovector<T> const& rhs) noexcept
+{
+	return lhs.first_index() == rhs.first_index() && lhs.size() == rhs.size()
+	    && detail::equal(lhs.begin(), rhs.begin(), (detail::size_type)(lhs.end() - lhs.begin()),
+	                     detail::is_bitwise_comparable<T>());
+}
+
+template <typename T>
+OVECTOR_NODISCARD
+OVECTOR_FORCE_INLINE
+bool operator!=(ovector<T> const& lhs, ovector<T> const& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+namespace detail
+{
+
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+size_type compact_into(ovector<T>& dst, ovector<T> const& src, compare_op op, T const& value, std::true_type) noexcept
+{
+	auto n = kernels(kernel_type_of<T>::value).compact(dst.end(), dst.max_size() - dst.size(),
+	                                                    src.begin(), (size_type)(src.end() - src.begin()), op, &value);
+	dst.uninitialized_grow_back_by(n);
+	return n;
+}
+
+template <typename T>
+size_type compact_into(ovector<T>& dst, ovector<T> const& src, compare_op op, T const& value, std::false_type)
+{
+	auto p = src.data();
+	auto s = src.size();
+	size_type n = 0;
+
+	for(size_type i = src.first_index(); i != s; ++i)
+	{
+		if(compare(p[i], op, value))
+		{
+			dst.push_back(p[i]);
+			++n;
+		}
+	}
+
+	return n;
+}
+
+} // namespace detail
+
+/**
+ * Find the first element equal to @p value.
+ * @return A pointer to the element, or @c end() if there is no such element.
+ * @note Complexity: O(n). The search is vectorized for 32-bit and 64-bit integers, @c float and @c double.
+ * The vectorized kernels are selected at runtime depending on the instruction sets supported by the cpu.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+T const* find(ovector<T> const& v, T const& value)
+{
+	auto p = v.begin();
+	return p + detail::find(p, (detail::size_type)(v.end() - p), value, detail::has_kernels<T>());
+}
+
+/**
+ * @copydoc find(ovector<T> const&, T const&)
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+T* find(ovector<T>& v, T const& value)
+{
+	auto p = v.begin();
+	return p + detail::find(p, (detail::size_type)(v.end() - p), value, detail::has_kernels<T>());
+}
+
+/**
+ * Count the elements equal to @p value.
+ * @note Complexity: O(n). Vectorized for the same types as @c find.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+typename ovector<T>::size_type count(ovector<T> const& v, T const& value)
+{
+	return detail::count(v.begin(), (detail::size_type)(v.end() - v.begin()), value, detail::has_kernels<T>());
+}
+
+/**
+ * Sum all elements.
+ * @return The sum, accumulated as @c long @c long or @c unsigned @c long @c long for integral types and as @c T
+ * otherwise. Integer sums wrap around on overflow.
+ * @note Complexity: O(n). Vectorized for the same types as @c find. The order of the additions is unspecified,
+ * which may affect the rounding of floating-point sums.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+typename detail::sum_type<T>::type sum(ovector<T> const& v)
+{
+	return detail::sum(v.begin(), (detail::size_type)(v.end() - v.begin()), detail::has_kernels<T>());
+}
+
+/**
+ * Get the smallest element.
+ * @pre @code !v.empty() @endcode
+ * @note Complexity: O(n). Vectorized for the same types as @c find. If a floating-point @c ovector contains NaN,
+ * the result is unspecified.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+T min_value(ovector<T> const& v)
+{
+	assert(!v.empty());
+	return detail::min_value(v.begin(), (detail::size_type)(v.end() - v.begin()), detail::has_kernels<T>());
+}
+
+/**
+ * Get the largest element.
+ * @pre @code !v.empty() @endcode
+ * @note Complexity: O(n). Vectorized for the same types as @c find. If a floating-point @c ovector contains NaN,
+ * the result is unspecified.
+ */
+template <typename T>
+OVECTOR_NODISCARD
+inline OVECTOR_FORCE_INLINE
+T max_value(ovector<T> const& v)
+{
+	assert(!v.empty());
+	return detail::max_value(v.begin(), (detail::size_type)(v.end() - v.begin()), detail::has_kernels<T>());
+}
+
+/**
+ * Append copies of all elements @c x of @p src for which @code x op value @endcode holds to @p dst, preserving
+ * their order.
+ * @return The number of appended elements.
+ * @pre @code &dst != &src @endcode
+ * @pre @p dst has enough space left for all selected elements.
+ * @note Complexity: O(n) in the size of @p src. Vectorized for the same types as @c find, in which case
+ * the selected elements are written straight into the uninitialized storage at the back of @p dst.
+ */
+template <typename T>
+inline OVECTOR_FORCE_INLINE
+typename ovector<T>::size_type compact_into(ovector<T>& dst, ovector<T> const& src, compare_op op, T const& value)
+{
+	return detail::compact_into(dst, src, op, value, detail::has_kernels<T>());
+}
+
+#ifdef OVECTOR_MEMORY_RESOURCE
+
+/**
+ * A @c std::pmr::memory_resource that hands out memory from a reserved region by bumping a pointer, like
+ * @c std::pmr::monotonic_buffer_resource. The region never moves and pages are committed on first use.
+ * @details Deallocation is a no-op, memory is reclaimed all at once by @c release. Running out of memory is
+ * detected before the guard page is reached: @c allocate throws @c std::bad_alloc, or terminates the program if
+ * exceptions are disabled.
+ */
+class ovector_memory_resource : public std::pmr::memory_resource
+{
+public:
+	using size_type = detail::size_type;
+
+private:
+	// size is the number of bytes handed out so far
+	detail::ovector_storage<unsigned char> _storage;
+
+	ovector_memory_resource(size_type max_size, ovector_options const& options) noexcept
+		: _storage(max_size, options)
+	{}
+
+	[[noreturn]]
+	static void exhausted()
+	{
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+		throw std::bad_alloc();
+#else
+		std::terminate();
+#endif
+	}
+
+public:
+	ovector_memory_resource(ovector_memory_resource const&) = delete;
+	ovector_memory_resource& operator=(ovector_memory_resource const&) = delete;
+
+	/**
+	 * Create a new @c ovector_memory_resource.
+	 * @param max_size The number of bytes that the resource can hand out in total until it is released.
+	 * @return The newly created resource. @c data() returns @c nullptr if the allocation failed, in which case
+	 * every allocation from the resource fails.
+	 */
+	OVECTOR_NODISCARD
+	static
+	ovector_memory_resource with_max_size_or_null(size_type max_size) noexcept
+	{
+		return ovector_memory_resource(max_size, ovector_options());
+	}
+
+	/**
+	 * Create a new @c ovector_memory_resource with given storage options.
+	 * @copydetails with_max_size_or_null(size_type)
+	 * @param options Options for the backing storage.
+	 */
+	OVECTOR_NODISCARD
+	static
+	ovector_memory_resource with_max_size_or_null(size_type max_size, ovector_options const& options) noexcept
+	{
+		return ovector_memory_resource(max_size, options);
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return data() != nullptr;
+	}
+
+	/**
+	 * Get the start of the region memory is handed out from.
+	 */
+	OVECTOR_NODISCARD
+	void const* data() const noexcept
+	{
+		return _storage.memory;
+	}
+
+	/**
+	 * Get the number of bytes handed out since creation or the last @c release, including alignment padding.
+	 */
+	OVECTOR_NODISCARD
+	size_type size() const noexcept
+	{
+		return _storage.size;
+	}
+
+	OVECTOR_NODISCARD
+	size_type max_size() const noexcept
+	{
+		return _storage.max_size;
+	}
+
+	/**
+	 * Reclaim all memory handed out so far, invalidating it.
+	 * @param discard_pages Return the pages used so far to the operating system instead of keeping them
+	 * committed for reuse.
+	 * @note Complexity: O(1), or a system call for @p discard_pages.
+	 */
+	void release(bool discard_pages = false) noexcept
+	{
+		if(discard_pages && _storage.size != 0)
+			detail::guarded_discard(_storage.memory, _storage.max_size, _storage.size);
+
+		_storage.size = 0;
+	}
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		auto memory = (std::uintptr_t)_storage.memory;
+		auto cursor = memory + _storage.size;
+		auto offset = (size_type)(((cursor + alignment - 1) & ~(std::uintptr_t)(alignment - 1)) - memory);
+
+		if(!_storage.memory || offset > _storage.max_size || _storage.max_size - offset < bytes)
+			exhausted();
+
+		_storage.size = offset + bytes;
+		return _storage.memory + offset;
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+	{
+		(void)p;
+		(void)bytes;
+		(void)alignment;
+	}
+
+	bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+#endif
+
+namespace detail
+{
+
+inline OVECTOR_FORCE_INLINE
+unsigned popcount64(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned)__builtin_popcountll(x);
+#else
+	// msvc's __popcnt64 requires the popcnt instruction
+	x = x - ((x >> 1) & 0x5555555555555555u);
+	x = (x & 0x3333333333333333u) + ((x >> 2) & 0x3333333333333333u);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fu;
+	return (unsigned)((x * 0x0101010101010101u) >> 56);
+#endif
+}
+
+// @pre x != 0
+inline OVECTOR_FORCE_INLINE
+unsigned count_trailing_zeros64(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned)__builtin_ctzll(x);
+#else
+	unsigned n = 0;
+
+	for(; !(x & 1); x >>= 1)
+		++n;
+
+	return n;
+#endif
+}
+
+// position of the set bit with index k
+// @pre k < popcount64(x)
+inline OVECTOR_FORCE_INLINE
+unsigned select64(std::uint64_t x, unsigned k) noexcept
+{
+	for(; k != 0; --k)
+		x &= x - 1;
+
+	return count_trailing_zeros64(x);
+}
+
+} // namespace detail
+
+/**
+ * A bit vector with the same guarantees as @c ovector: the storage for all bits is reserved up front and never
+ * reallocated. Bits are packed into 64-bit words.
+ * @details Optionally maintains a rank index, one cumulative count of set bits per 512 bits, which makes @c rank
+ * O(1) and @c select O(log n). The index grows as bits are appended. Modifying bits that were already appended
+ * invalidates the index from the modified block on, until @c update_rank_index is called. @c rank and @c select
+ * stay correct without the index, but count the bits not covered by it.
+ */
+class obitvector
+{
+public:
+	using size_type = detail::size_type;
+
+	/** Number of bits covered by one entry of the rank index. */
+	static constexpr size_type rank_block_bits = 512;
+
+private:
+	static constexpr size_type word_bits = 64;
+	static constexpr size_type block_words = rank_block_bits / word_bits;
+
+	// size counts bits, max_size counts words. bits beyond the size are always zero.
+	detail::ovector_storage<std::uint64_t> _words;
+	size_type _max_size;
+	// _rank.memory[b] is the number of set bits before block b, valid for b <= _rank_valid
+	detail::ovector_storage<std::uint64_t> _rank;
+	size_type _rank_valid;
+
+	obitvector(size_type max_size, bool rank_index, ovector_options const& options) noexcept
+		: _words((max_size + word_bits - 1) / word_bits, options), _max_size(_words.memory ? max_size : 0),
+		  _rank(), _rank_valid(0)
+	{
+		if(rank_index && _words.memory)
+		{
+			_rank = detail::ovector_storage<std::uint64_t>(_words.max_size / block_words + 1, ovector_options());
+
+			if(!_rank.memory)
+			{
+				_words = detail::ovector_storage<std::uint64_t>();
+				_max_size = 0;
+			}
+		}
+	}
+
+	// the kernels use the popcnt instruction, which the header cannot assume
+	OVECTOR_FORCE_INLINE
+	size_type ones_in_words(size_type first, size_type last) const noexcept
+	{
+		return detail::popcount_kernel_for()(_words.memory + first, last - first);
+	}
+
+	// extends the rank index over the blocks completed by appending to a vector of oldSize bits, unless it is
+	// already behind
+	OVECTOR_FORCE_INLINE
+	void blocks_completed(size_type oldSize) noexcept
+	{
+		auto before = oldSize / rank_block_bits;
+		auto after = _words.size / rank_block_bits;
+
+		if(!_rank.memory || _rank_valid != before)
+			return;
+
+		for(auto b = before; b != after; ++b)
+			_rank.memory[b + 1] = _rank.memory[b] + ones_in_words(b * block_words, (b + 1) * block_words);
+
+		_rank_valid = after;
+	}
+
+	OVECTOR_FORCE_INLINE
+	void invalidate_rank(size_type bit) noexcept
+	{
+		auto block = bit / rank_block_bits;
+
+		if(_rank_valid > block)
+			_rank_valid = block;
+	}
+
+	OVECTOR_FORCE_INLINE
+	size_type word_count() const noexcept
+	{
+		return (_words.size + word_bits - 1) / word_bits;
+	}
+
+public:
+	/**
+	 * Construct an @c obitvector without backing storage.
+	 * @post @code data() == nullptr @endcode
+	 * @post @code size() == 0 @endcode
+	 * @post @code max_size() == 0 @endcode
+	 */
+	obitvector() noexcept
+		: _words(), _max_size(0), _rank(), _rank_valid(0)
+	{}
+
+	obitvector(obitvector&& other) noexcept
+		: _words(detail::inlined_move(other._words)),
+		  _max_size(detail::inlined_exchange(other._max_size, 0)),
+		  _rank(detail::inlined_move(other._rank)),
+		  _rank_valid(detail::inlined_exchange(other._rank_valid, 0))
+	{}
+
+	obitvector& operator=(obitvector&& other) noexcept
+	{
+		_words = detail::inlined_move(other._words);
+		_max_size = detail::inlined_exchange(other._max_size, 0);
+		_rank = detail::inlined_move(other._rank);
+		_rank_valid = detail::inlined_exchange(other._rank_valid, 0);
+		return *this;
+	}
+
+	/**
+	 * Create a new @c obitvector with given capacity.
+	 * @param max_size The number of bits that the @c obitvector should have storage capacity for.
+	 * @param rank_index Whether to maintain the rank index, which takes another 1/8 of the storage for the bits.
+	 * @return The newly created @c obitvector. @c data() returns @c nullptr if the allocation failed.
+	 */
+	OVECTOR_NODISCARD
+	static
+	obitvector with_max_size_or_null(size_type max_size, bool rank_index = false) noexcept
+	{
+		return obitvector(max_size, rank_index, ovector_options());
+	}
+
+	/**
+	 * Create a new @c obitvector with given capacity and storage options for the bits.
+	 * @copydetails with_max_size_or_null(size_type, bool)
+	 * @param options Options for the backing storage of the bits.
+	 */
+	OVECTOR_NODISCARD
+	static
+	obitvector with_max_size_or_null(size_type max_size, bool rank_index, ovector_options const& options) noexcept
+	{
+		return obitvector(max_size, rank_index, options);
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return data() != nullptr;
+	}
+
+	/**
+	 * Get direct access to the words storing the bits. Bit @c i is bit @code i % 64 @endcode of word
+	 * @code i / 64 @endcode. Bits beyond @c size() are zero.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	std::uint64_t const* data() const noexcept
+	{
+		return _words.memory;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type size() const noexcept
+	{
+		return _words.size;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type max_size() const noexcept
+	{
+		return _max_size;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool empty() const noexcept
+	{
+		return _words.size == 0;
+	}
+
+	/**
+	 * Whether this @c obitvector maintains a rank index.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool has_rank_index() const noexcept
+	{
+		return _rank.memory != nullptr;
+	}
+
+	/**
+	 * Append a bit.
+	 * @pre @code size() != max_size() @endcode
+	 * @note Complexity: O(1). Only extending the rank index branches, once every 512 bits.
+	 */
+	OVECTOR_FORCE_INLINE
+	void push_back(bool value) noexcept
+	{
+		auto i = _words.size;
+		assert(i != _max_size);
+		_words.memory[i / word_bits] |= (std::uint64_t)value << (i % word_bits);
+		_words.size = i + 1;
+
+		if((i + 1) % rank_block_bits == 0)
+			blocks_completed(i);
+	}
+
+	/**
+	 * Append the @p n lowest bits of @p bits, starting with the least significant bit.
+	 * @pre @code n <= 64 && max_size() - size() >= n @endcode
+	 * @note Complexity: O(1)
+	 */
+	OVECTOR_FORCE_INLINE
+	void append_word(std::uint64_t bits, size_type n) noexcept
+	{
+		assert(n <= word_bits && _max_size - _words.size >= n);
+
+		if(n == 0)
+			return;
+
+		bits &= ~std::uint64_t() >> (word_bits - n);
+
+		auto i = _words.size;
+		auto offset = i % word_bits;
+		_words.memory[i / word_bits] |= bits << offset;
+
+		if(offset != 0 && offset + n > word_bits)
+			_words.memory[i / word_bits + 1] = bits >> (word_bits - offset);
+
+		_words.size = i + n;
+
+		if(i / rank_block_bits != _words.size / rank_block_bits)
+			blocks_completed(i);
+	}
+
+	/**
+	 * Remove the last bit.
+	 * @pre @code !empty() @endcode
+	 */
+	OVECTOR_FORCE_INLINE
+	void pop_back() noexcept
+	{
+		assert(!empty());
+		auto i = --_words.size;
+		_words.memory[i / word_bits] &= ~((std::uint64_t)1 << (i % word_bits));
+		invalidate_rank(i);
+	}
+
+	/**
+	 * Remove all bits.
+	 * @post @code size() == 0 @endcode
+	 * @note Complexity: O(n), the used words are cleared.
+	 */
+	void clear() noexcept
+	{
+		if(_words.memory)
+			std::memset(_words.memory, 0, word_count() * sizeof(std::uint64_t));
+
+		_words.size = 0;
+		_rank_valid = 0;
+	}
+
+	/**
+	 * @pre @code i < size() @endcode
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool test(size_type i) const noexcept
+	{
+		assert(i < size());
+		return (_words.memory[i / word_bits] >> (i % word_bits)) & 1;
+	}
+
+	/**
+	 * @copydoc test
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool operator[](size_type i) const noexcept
+	{
+		return test(i);
+	}
+
+	/**
+	 * Set bit @p i to @p value.
+	 * @pre @code i < size() @endcode
+	 */
+	OVECTOR_FORCE_INLINE
+	void set(size_type i, bool value = true) noexcept
+	{
+		assert(i < size());
+		auto& word = _words.memory[i / word_bits];
+		auto mask = (std::uint64_t)1 << (i % word_bits);
+		word = (word & ~mask) | ((std::uint64_t)value << (i % word_bits));
+		invalidate_rank(i);
+	}
+
+	/**
+	 * Clear bit @p i.
+	 * @pre @code i < size() @endcode
+	 */
+	OVECTOR_FORCE_INLINE
+	void reset(size_type i) noexcept
+	{
+		set(i, false);
+	}
+
+	/**
+	 * Invert bit @p i.
+	 * @pre @code i < size() @endcode
+	 */
+	OVECTOR_FORCE_INLINE
+	void flip(size_type i) noexcept
+	{
+		assert(i < size());
+		_words.memory[i / word_bits] ^= (std::uint64_t)1 << (i % word_bits);
+		invalidate_rank(i);
+	}
+
+	/**
+	 * Invert all bits.
+	 * @note Complexity: O(n / 64)
+	 */
+	void flip() noexcept
+	{
+		auto words = _words.memory;
+		auto n = word_count();
+
+		for(size_type i = 0; i != n; ++i)
+			words[i] = ~words[i];
+
+		if(_words.size % word_bits != 0)
+			words[n - 1] &= ~std::uint64_t() >> (word_bits - _words.size % word_bits);
+
+		invalidate_rank(0);
+	}
+
+	/**
+	 * Combine with the bits of @p other word by word.
+	 * @pre @code size() == other.size() @endcode
+	 * @note Complexity: O(n / 64)
+	 */
+	obitvector& operator&=(obitvector const& other) noexcept
+	{
+		assert(size() == other.size());
+		auto words = _words.memory;
+		auto n = word_count();
+
+		for(size_type i = 0; i != n; ++i)
+			words[i] &= other._words.memory[i];
+
+		invalidate_rank(0);
+		return *this;
+	}
+
+	/**
+	 * @copydoc operator&=
+	 */
+	obitvector& operator|=(obitvector const& other) noexcept
+	{
+		assert(size() == other.size());
+		auto words = _words.memory;
+		auto n = word_count();
+
+		for(size_type i = 0; i != n; ++i)
+			words[i] |= other._words.memory[i];
+
+		invalidate_rank(0);
+		return *this;
+	}
+
+	/**
+	 * @copydoc operator&=
+	 */
+	obitvector& operator^=(obitvector const& other) noexcept
+	{
+		assert(size() == other.size());
+		auto words = _words.memory;
+		auto n = word_count();
+
+		for(size_type i = 0; i != n; ++i)
+			words[i] ^= other._words.memory[i];
+
+		invalidate_rank(0);
+		return *this;
+	}
+
+	/**
+	 * Count the set bits.
+	 * @note Complexity: O(n / 64), vectorized.
+	 */
+	OVECTOR_NODISCARD
+	size_type count() const noexcept
+	{
+		if(!_words.memory)
+			return 0;
+
+		return detail::popcount_kernel_for()(_words.memory, word_count());
+	}
+
+	/**
+	 * Count the set bits before position @p i.
+	 * @pre @code i <= size() @endcode
+	 * @note Complexity: O(1) if the rank index covers @p i, otherwise O(n / 64) for the bits not covered.
+	 */
+	OVECTOR_NODISCARD
+	size_type rank(size_type i) const noexcept
+	{
+		assert(i <= size());
+
+		if(i == 0)
+			return 0;
+
+		size_type block = 0;
+		size_type n = 0;
+
+		if(_rank.memory)
+		{
+			block = i / rank_block_bits < _rank_valid ? i / rank_block_bits : _rank_valid;
+			n = _rank.memory[block];
+		}
+
+		auto word = i / word_bits;
+		n += ones_in_words(block * block_words, word);
+
+		if(i % word_bits != 0)
+			n += detail::popcount64(_words.memory[word] << (word_bits - i % word_bits));
+
+		return n;
+	}
+
+	/**
+	 * Find the position of the set bit with index @p k, i.e. the inverse of @c rank.
+	 * @return The position, or @c size() if fewer than @code k + 1 @endcode bits are set.
+	 * @note Complexity: O(log n) if the rank index covers the bit, otherwise O(n / 64) for the bits not covered.
+	 */
+	OVECTOR_NODISCARD
+	size_type select(size_type k) const noexcept
+	{
+		size_type word = 0;
+
+		if(_rank.memory && _rank_valid != 0)
+		{
+			// last block that starts with fewer than k + 1 set bits before it
+			auto counts = _rank.memory;
+			auto block = (size_type)(std::upper_bound(counts, counts + _rank_valid + 1, k) - counts) - 1;
+			k -= counts[block];
+			word = block * block_words;
+		}
+
+		auto words = _words.memory;
+		auto n = word_count();
+
+		for(; word < n; ++word)
+		{
+			auto ones = detail::popcount64(words[word]);
+
+			if(k < ones)
+				return word * word_bits + detail::select64(words[word], (unsigned)k);
+
+			k -= ones;
+		}
+
+		return size();
+	}
+
+	/**
+	 * Bring the rank index up to date after bits were modified.
+	 * @note Complexity: O(bits not covered by the index / 64)
+	 */
+	void update_rank_index() noexcept
+	{
+		if(!_rank.memory)
+			return;
+
+		auto complete = _words.size / rank_block_bits;
+
+		for(auto b = _rank_valid; b != complete; ++b)
+			_rank.memory[b + 1] = _rank.memory[b] + ones_in_words(b * block_words, (b + 1) * block_words);
+
+		_rank_valid = complete;
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap(obitvector& other) noexcept
+	{
+		detail::inlined_swap(_words.memory, other._words.memory);
+		detail::inlined_swap(_words.size, other._words.size);
+		detail::inlined_swap(_words.max_size, other._words.max_size);
+		detail::inlined_swap(_max_size, other._max_size);
+		detail::inlined_swap(_rank.memory, other._rank.memory);
+		detail::inlined_swap(_rank.size, other._rank.size);
+		detail::inlined_swap(_rank.max_size, other._rank.max_size);
+		detail::inlined_swap(_rank_valid, other._rank_valid);
+	}
+};
+
+inline OVECTOR_FORCE_INLINE
+void swap(obitvector& lhs, obitvector& rhs) noexcept
+{
+	lhs.swap(rhs);
+}
+
+namespace detail
+{
+
+// shared by the producer and the consumers of an ovector_stream. bit 0 of the futex word is set by consumers
+// before they wait and cleared by the wakeup, which also counts up the remaining bits. the producer only takes the
+// slow path to wake consumers if the bit is set, so a consumer that was woken but did not run yet does not cost
+// another wakeup.
+struct stream_sync
+{
+	std::atomic<size_type> size;
+	std::atomic<std::uint32_t> futex;
+	std::atomic<bool> closed;
+
+	stream_sync() noexcept
+		: size(0), futex(0), closed(false)
+	{}
+};
+
+// a coroutine suspended until a stream reaches a size
+struct stream_waiter
+{
+	stream_waiter* next;
+	stream_sync* sync;
+	size_type target;
+	void (*resume)(stream_waiter* waiter);
+};
+
+// blocks until the size reaches n, the stream is closed or timeoutNs nanoseconds passed, forever if negative.
+// returns whether the size was reached.
+bool stream_wait(stream_sync& sync, size_type n, std::int64_t timeoutNs) noexcept;
+
+// wakes the waiting threads and resumes the coroutines that are done waiting
+void stream_wake(stream_sync& sync) noexcept;
+
+// suspends the waiter until it is done waiting. returns false without suspending if it already is.
+bool stream_park(stream_waiter* waiter) noexcept;
+
+} // namespace detail
+
+/**
+ * An append-only @c ovector that one producer thread appends to while any number of consumer threads read the
+ * elements appended so far and wait for more, which makes it an in-process stream without copies.
+ * @details Appending publishes the new size with one atomic store and one atomic load that tells whether consumers
+ * are waiting, and only takes a slow path to wake them if there are any. Waiting consumers block on a futex on Linux and on a
+ * condition variable elsewhere. Published elements never move and are not modified by the stream, so consumers can
+ * read them without further synchronization.
+ * @warning Moving or destroying a stream while other threads use it is undefined behavior.
+ */
+template <typename T>
+class ovector_stream
+{
+public:
+	using value_type = T;
+	using const_reference = T const&;
+	using const_iterator = T const*;
+	using size_type = detail::size_type;
+
+private:
+	// only accessed by the producer, except for the data pointer
+	ovector<T> _elements;
+	mutable detail::stream_sync _sync;
+
+	OVECTOR_FORCE_INLINE
+	ovector_stream(size_type max_size, ovector_options const& options) noexcept
+		: _elements(ovector<T>::with_max_size_or_null(max_size, options))
+	{}
+
+	OVECTOR_FORCE_INLINE
+	void publish() noexcept
+	{
+		// both sequentially consistent: either this load sees a consumer that started waiting or that consumer
+		// sees the new size before it blocks
+		_sync.size.store(_elements.size());
+
+		if(_sync.futex.load() & 1)
+			detail::stream_wake(_sync);
+	}
+
+public:
+	ovector_stream(ovector_stream const&) = delete;
+	ovector_stream& operator=(ovector_stream const&) = delete;
+	ovector_stream& operator=(ovector_stream&&) = delete;
+
+	/**
+	 * Construct a stream from another by moving its contents. Afterwards the moved-from stream is not backed by
+	 * storage.
+	 */
+	ovector_stream(ovector_stream&& other) noexcept
+		: _elements(detail::inlined_move(other._elements))
+	{
+		_sync.size.store(other._sync.size.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+		_sync.closed.store(other._sync.closed.exchange(false, std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	/**
+	 * Create a new stream with given capacity.
+	 * @param max_size The number of elements that can be appended to the stream.
+	 * @return The newly created stream. @c data() returns @c nullptr if the allocation failed.
+	 */
+	OVECTOR_NODISCARD
+	static
+	ovector_stream with_max_size_or_null(size_type max_size) noexcept
+	{
+		return ovector_stream(max_size, ovector_options());
+	}
+
+	/**
+	 * Create a new stream with given capacity and storage options.
+	 * @copydetails with_max_size_or_null(size_type)
+	 * @param options Options for the backing storage.
+	 */
+	OVECTOR_NODISCARD
+	static
+	ovector_stream with_max_size_or_null(size_type max_size, ovector_options const& options) noexcept
+	{
+		return ovector_stream(max_size, options);
+	}
+
+	/**
+	 * Append a new element constructed with given arguments and make it visible to the consumers.
+	 * @return A pointer to the new element.
+	 * @throw Any exception thrown by the constructor.
+	 * @pre Only called by the producer.
+	 * @pre @code size() &lt; max_size() @endcode
+	 * @pre The stream is not closed.
+	 * @note Complexity: O(1), plus waking the consumers if any are waiting. Coroutines waiting for the new size are
+	 * resumed on this thread before it returns.
+	 */
+	template <typename... Args>
+	OVECTOR_FORCE_INLINE
+	T* emplace_back(Args&&... args) noexcept(noexcept(T(detail::inlined_forward<Args>(args)...)))
+	{
+		auto p = _elements.emplace_back(detail::inlined_forward<Args>(args)...);
+		publish();
+		return p;
+	}
+
+	/**
+	 * Append a copy of @p value.
+	 * @see @c emplace_back
+	 */
+	OVECTOR_FORCE_INLINE
+	T* push_back(T const& value) noexcept(noexcept(emplace_back(value)))
+	{
+		return emplace_back(value);
+	}
+
+	/**
+	 * Append @p value by moving it.
+	 * @see @c emplace_back
+	 */
+	OVECTOR_FORCE_INLINE
+	T* push_back(T&& value) noexcept(noexcept(emplace_back(detail::inlined_move(value))))
+	{
+		return emplace_back(detail::inlined_move(value));
+	}
+
+	/**
+	 * Append copies of the elements in the range [first, last) and make them visible to the consumers at once.
+	 * @throw Any exception thrown by the constructor. The elements appended until then are made visible by the
+	 * next append.
+	 * @pre Only called by the producer.
+	 * @pre @code size() + std::distance(first, last) &lt;= max_size() @endcode
+	 * @pre The stream is not closed.
+	 */
+	template <typename It>
+	void append(It first, It last)
+	{
+		for(; first != last; ++first)
+			_elements.emplace_back(*first);
+
+		publish();
+	}
+
+	/**
+	 * Mark the end of the stream and wake all consumers. Waiting for a size that was not reached fails afterwards.
+	 * @pre Only called by the producer.
+	 */
+	void close() noexcept
+	{
+		_sync.closed.store(true);
+		detail::stream_wake(_sync);
+	}
+
+	/**
+	 * Check whether the producer closed the stream.
+	 */
+	OVECTOR_NODISCARD
+	bool closed() const noexcept
+	{
+		return _sync.closed.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Get the number of elements visible to the caller.
+	 * @return The number of elements appended so far, the elements [0, size()) can be read.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type size() const noexcept
+	{
+		return _sync.size.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Get the maximum size of this stream.
+	 * @return The number of elements that can be appended, or @c 0 if the stream is not backed by storage.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type max_size() const noexcept
+	{
+		return _elements.max_size();
+	}
+
+	/**
+	 * Get direct access to the elements.
+	 * @return A pointer to the storage, or @c nullptr if this stream is not backed by storage.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const* data() const noexcept
+	{
+		return _elements.data();
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const& operator[](size_type index) const noexcept
+	{
+		assert(index < size());
+		return data()[index];
+	}
+
+	/**
+	 * Block until at least @p n elements were appended.
+	 * @return @c true if the size was reached, @c false if the stream was closed before.
+	 * @note Returns right away without a system call if the size was already reached.
+	 */
+	bool wait_until_size(size_type n) const noexcept
+	{
+		return size() >= n || detail::stream_wait(_sync, n, -1);
+	}
+
+	/**
+	 * Block until at least @p n elements were appended or @p timeout passed.
+	 * @return @c true if the size was reached, @c false if the stream was closed before or the wait timed out.
+	 */
+	template <typename Rep, typename Period>
+	bool wait_until_size(size_type n, std::chrono::duration<Rep, Period> const& timeout) const noexcept
+	{
+		if(size() >= n)
+			return true;
+
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+		return detail::stream_wait(_sync, n, ns < 0 ? 0 : (std::int64_t)ns);
+	}
+
+#ifdef OVECTOR_COROUTINES
+	/**
+	 * Awaitable returned by @c async_wait_until_size. The result of @c co_await has the same meaning as the
+	 * result of @c wait_until_size.
+	 */
+	class size_awaiter : detail::stream_waiter
+	{
+		std::coroutine_handle<> _handle;
+
+		static void resume_handle(detail::stream_waiter* waiter)
+		{
+			static_cast<size_awaiter*>(waiter)->_handle.resume();
+		}
+
+	public:
+		size_awaiter(detail::stream_sync& sync, size_type n) noexcept
+			: detail::stream_waiter{nullptr, &sync, n, &resume_handle}
+		{}
+
+		bool await_ready() const noexcept
+		{
+			return sync->size.load(std::memory_order_acquire) >= target || sync->closed.load();
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			_handle = handle;
+			return detail::stream_park(this);
+		}
+
+		bool await_resume() const noexcept
+		{
+			return sync->size.load(std::memory_order_acquire) >= target;
+		}
+	};
+
+	/**
+	 * Suspend the calling coroutine until at least @p n elements were appended, without blocking a thread.
+	 * @return An awaitable, @code co_await stream.async_wait_until_size(n) @endcode evaluates to the same result
+	 * as @c wait_until_size.
+	 * @note The coroutine is resumed on the producer thread, inside the append or @c close that reached the size.
+	 * Hand the work off to an executor if it takes long.
+	 */
+	OVECTOR_NODISCARD
+	size_awaiter async_wait_until_size(size_type n) const noexcept
+	{
+		return size_awaiter(_sync, n);
+	}
+#endif
+};
+
+/**
+ * A fixed-size array for sparse indices, e.g. ids from a 64-bit range, that only uses memory for the pages holding
+ * non-zero elements. Any index below @c max_size can be written, elements that were never written read as zero.
+ * @details The storage for all elements is reserved up front like for @c ovector, so lookups are a plain array
+ * access. An element is empty if all of its bytes, including padding, are zero. The number of non-empty elements
+ * overlapping each page is kept in a side table, and a page is returned to the operating system as soon as its
+ * last element is erased. A bitmap of the pages holding elements makes iterating over them proportional to the
+ * number of populated pages plus one bit per page of the reservation.
+ * @tparam T A trivially copyable type.
+ */
+template <typename T>
+class sparse_ovector
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable to be stored in a sparse_ovector");
+
+public:
+	using value_type = T;
+	using const_reference = T const&;
+	using size_type = detail::size_type;
+
+private:
+	static constexpr size_type page_size = detail::page_size;
+
+	// size is the number of non-empty elements
+	detail::ovector_storage<T> _slots;
+	// the number of non-empty elements overlapping each page, at most one per byte plus one
+	detail::ovector_storage<std::uint16_t> _page_counts;
+	// one bit per page with a non-zero count
+	detail::ovector_storage<std::uint64_t> _page_bits;
+
+	static
+	ovector_options slot_options(ovector_options options) noexcept
+	{
+		// pages must start at element boundaries of the storage and read as zero after being discarded, which a
+		// snapshot mapping does not do
+		if(options.alignment < page_size)
+			options.alignment = page_size;
+
+		options.snapshots = false;
+		return options;
+	}
+
+	sparse_ovector(size_type max_size, ovector_options const& options) noexcept
+		: _slots(max_size, slot_options(options)), _page_counts(), _page_bits()
+	{
+		if(!_slots.memory)
+			return;
+
+		auto pages = page_count();
+		_page_counts = detail::ovector_storage<std::uint16_t>(pages, ovector_options());
+		_page_bits = detail::ovector_storage<std::uint64_t>((pages + 63) / 64, ovector_options());
+
+		if(!_page_counts.memory || !_page_bits.memory)
+		{
+			*this = sparse_ovector();
+			return;
+		}
+
+		// a huge page would commit hundreds of pages on the first write to one of them
+		auto dataSize = _slots.max_size * sizeof(T);
+		detail::guarded_advise(_slots.memory, dataSize, 0, dataSize, detail::page_advice::small_pages);
+	}
+
+	OVECTOR_FORCE_INLINE
+	size_type page_count() const noexcept
+	{
+		return (_slots.max_size * sizeof(T) + page_size - 1) / page_size;
+	}
+
+	OVECTOR_FORCE_INLINE
+	static bool is_zero(T const& value) noexcept
+	{
+		auto bytes = (unsigned char const*)&value;
+		unsigned char any = 0;
+
+		for(size_type i = 0; i != sizeof(T); ++i)
+			any |= bytes[i];
+
+		return any == 0;
+	}
+
+	void page_filled(size_type page) noexcept
+	{
+		if(_page_counts.memory[page]++ == 0)
+			_page_bits.memory[page / 64] |= (std::uint64_t)1 << (page % 64);
+	}
+
+	void page_emptied(size_type page) noexcept
+	{
+		if(--_page_counts.memory[page] != 0)
+			return;
+
+		_page_bits.memory[page / 64] &= ~((std::uint64_t)1 << (page % 64));
+
+		auto dataSize = _slots.max_size * sizeof(T);
+		auto last = (page + 1) * page_size;
+		detail::guarded_zero(_slots.memory, page * page_size, last < dataSize ? last : dataSize);
+	}
+
+	// updates the pages overlapped by the element at index after it was populated or emptied
+	void element_changed(size_type index, bool populated) noexcept
+	{
+		auto firstPage = index * sizeof(T) / page_size;
+		auto lastPage = ((index + 1) * sizeof(T) - 1) / page_size;
+
+		for(auto page = firstPage; page <= lastPage; ++page)
+		{
+			if(populated)
+				page_filled(page);
+			else
+				page_emptied(page);
+		}
+
+		_slots.size += populated ? 1 : (size_type)-1;
+	}
+
+	template <typename F>
+	void visit_page(size_type page, F& f) const
+	{
+		// every element is visited from the page holding its first byte
+		auto first = (page * page_size + sizeof(T) - 1) / sizeof(T);
+		auto last = ((page + 1) * page_size + sizeof(T) - 1) / sizeof(T);
+
+		if(last > _slots.max_size)
+			last = _slots.max_size;
+
+		for(auto i = first; i < last; ++i)
+			if(!is_zero(_slots.memory[i]))
+				f(i, _slots.memory[i]);
+	}
+
+public:
+	/**
+	 * Construct a @c sparse_ovector without backing storage.
+	 * @post @code data() == nullptr @endcode
+	 * @post @code max_size() == 0 @endcode
+	 */
+	sparse_ovector() noexcept = default;
+
+	sparse_ovector(sparse_ovector&&) noexcept = default;
+	sparse_ovector& operator=(sparse_ovector&&) noexcept = default;
+
+	/**
+	 * Create a new @c sparse_ovector.
+	 * @param max_size The number of elements, i.e. one more than the largest index that can be used.
+	 * @return The newly created @c sparse_ovector. @c data() returns @c nullptr if the allocation failed.
+	 * @note Reserves @c max_size elements plus 1/2048 of that for the page counts, none of which uses memory until
+	 * it is written to.
+	 */
+	OVECTOR_NODISCARD
+	static
+	sparse_ovector with_max_size_or_null(size_type max_size) noexcept
+	{
+		return sparse_ovector(max_size, ovector_options());
+	}
+
+	/**
+	 * Create a new @c sparse_ovector with given storage options.
+	 * @copydetails with_max_size_or_null(size_type)
+	 * @param options Options for the storage of the elements. The alignment is at least the page size and
+	 * @c ovector_options::snapshots is ignored.
+	 */
+	OVECTOR_NODISCARD
+	static
+	sparse_ovector with_max_size_or_null(size_type max_size, ovector_options const& options) noexcept
+	{
+		return sparse_ovector(max_size, options);
+	}
+
+	/**
+	 * Get direct read access to the elements.
+	 * @return A pointer to the storage, or @c nullptr if this @c sparse_ovector is not backed by storage.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const* data() const noexcept
+	{
+		return _slots.memory;
+	}
+
+	/**
+	 * Get the number of non-empty elements.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type size() const noexcept
+	{
+		return _slots.size;
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Get the number of elements that can be indexed.
+	 * @return One more than the largest valid index, or @c 0 if this @c sparse_ovector is not backed by storage.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type max_size() const noexcept
+	{
+		return _slots.max_size;
+	}
+
+	/**
+	 * Read the element at @p index, which is zero if it was never written or erased.
+	 * @pre @code index &lt; max_size() @endcode
+	 * @note Complexity: O(1). Reading does not allocate memory, untouched pages are backed by a shared zero page.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	T const& operator[](size_type index) const noexcept
+	{
+		assert(index < max_size());
+		return _slots.memory[index];
+	}
+
+	/**
+	 * Check whether the element at @p index is not empty.
+	 * @pre @code index &lt; max_size() @endcode
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool contains(size_type index) const noexcept
+	{
+		return !is_zero((*this)[index]);
+	}
+
+	/**
+	 * Write the element at @p index. Writing an empty value erases the element.
+	 * @pre @code index &lt; max_size() @endcode
+	 * @note Complexity: O(1). Populating an element on a new page commits that page, erasing the last element on
+	 * a page returns the page to the operating system.
+	 */
+	void set(size_type index, T const& value) noexcept
+	{
+		assert(index < max_size());
+
+		auto slot = _slots.memory + index;
+		auto wasEmpty = is_zero(*slot);
+		auto isEmpty = is_zero(value);
+
+		// writing would commit the page for nothing
+		if(wasEmpty && isEmpty)
+			return;
+
+		std::memcpy((void*)slot, &value, sizeof(T));
+
+		if(wasEmpty != isEmpty)
+			element_changed(index, !isEmpty);
+	}
+
+	/**
+	 * Erase the element at @p index, which then reads as zero.
+	 * @see @c set
+	 */
+	void erase(size_type index) noexcept
+	{
+		assert(index < max_size());
+
+		auto slot = _slots.memory + index;
+
+		if(is_zero(*slot))
+			return;
+
+		std::memset((void*)slot, 0, sizeof(T));
+		element_changed(index, false);
+	}
+
+	/**
+	 * Erase all elements and return their pages to the operating system.
+	 * @post @code empty() @endcode
+	 */
+	void clear() noexcept
+	{
+		if(!_slots.memory)
+			return;
+
+		detail::guarded_zero(_slots.memory, 0, _slots.max_size * sizeof(T));
+		detail::guarded_zero(_page_counts.memory, 0, _page_counts.max_size * sizeof(std::uint16_t));
+		detail::guarded_zero(_page_bits.memory, 0, _page_bits.max_size * sizeof(std::uint64_t));
+		_slots.size = 0;
+	}
+
+	/**
+	 * Get the number of pages holding non-empty elements, which is the memory used by the elements in pages of
+	 * @c detail::page_size bytes.
+	 * @note Complexity: O(max_size() / (64 * elements per page)).
+	 */
+	OVECTOR_NODISCARD
+	size_type populated_pages() const noexcept
+	{
+		size_type n = 0;
+
+		for(size_type w = 0; w != _page_bits.max_size; ++w)
+			n += detail::popcount64(_page_bits.memory[w]);
+
+		return n;
+	}
+
+	/**
+	 * Invoke @c f(index,value) for every non-empty element, in ascending order of the indices.
+	 * @note Complexity: O(max_size() / (64 * elements per page)) to find the populated pages, plus O(elements per
+	 * page) for each of them.
+	 */
+	template <typename F>
+	void for_each(F f) const
+	{
+		for(size_type w = 0; w != _page_bits.max_size; ++w)
+		{
+			for(auto bits = _page_bits.memory[w]; bits != 0; bits &= bits - 1)
+				visit_page(w * 64 + detail::count_trailing_zeros64(bits), f);
+		}
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap(sparse_ovector& other) noexcept
+	{
+		detail::inlined_swap(_slots.memory, other._slots.memory);
+		detail::inlined_swap(_slots.size, other._slots.size);
+		detail::inlined_swap(_slots.max_size, other._slots.max_size);
+		detail::inlined_swap(_page_counts.memory, other._page_counts.memory);
+		detail::inlined_swap(_page_counts.size, other._page_counts.size);
+		detail::inlined_swap(_page_counts.max_size, other._page_counts.max_size);
+		detail::inlined_swap(_page_bits.memory, other._page_bits.memory);
+		detail::inlined_swap(_page_bits.size, other._page_bits.size);
+		detail::inlined_swap(_page_bits.max_size, other._page_bits.max_size);
+	}
+};
+
+template <typename T>
+OVECTOR_FORCE_INLINE
+void swap(sparse_ovector<T>& lhs, sparse_ovector<T>& rhs) noexcept
 {
-	return !(lhs == rhs);
+	lhs.swap(rhs);
+}
+
+/**
+ * A sorted multiset for data that is appended constantly, organized as sorted runs like a log-structured merge tree.
+ * @details Elements are appended to an unsorted buffer. Once the buffer is full, it is sorted and sealed into an
+ * immutable sorted run. Whenever @c fanout runs of the same tier exist, they are merged into one run of the next
+ * tier, so every element is moved O(log(n / buffer_size)) times and there are at most @c fanout - 1 runs per tier.
+ * Merging happens in the inserting thread when the buffer is sealed. Lookups scan the buffer and search every run
+ * with a branchless binary search, newest first.
+ *
+ * Every run has its own storage, so the elements of a sealed run stay at their address until the run is merged.
+ * @tparam T A nothrow move constructible type.
+ * @tparam Compare A default constructible strict weak ordering of the elements.
+ */
+template <typename T, typename Compare = std::less<T>>
+class sorted_ovector
+{
+	static_assert(std::is_nothrow_move_constructible<T>::value, "T must be nothrow move constructible");
+
+public:
+	using value_type = T;
+	using const_reference = T const&;
+	using size_type = detail::size_type;
+	using value_compare = Compare;
+
+	/**
+	 * The number of runs of one tier that are merged into a run of the next tier.
+	 */
+	static constexpr size_type fanout = 4;
+
+private:
+	struct run
+	{
+		ovector<T> elements;
+		size_type tier;
+	};
+
+	struct cursor
+	{
+		T* next;
+		T* end;
+	};
+
+	// a run of tier t holds at least fanout^t buffers, so there are fewer than 64 tiers, each with fewer than fanout
+	// runs once merged, plus the run just sealed
+	static constexpr size_type max_runs = (fanout - 1) * 64 + 1;
+
+	ovector<T> _buffer;
+	// ordered from oldest to newest, which makes the tiers non-increasing
+	ovector<run> _runs;
+	// the number of elements in the runs
+	size_type _sealed = 0;
+	ovector_options _options;
+	Compare _compare;
+
+	sorted_ovector(size_type buffer_size, ovector_options const& options) noexcept
+		: _buffer(ovector<T>::with_max_size_or_null(buffer_size, options)),
+		  _runs(ovector<run>::with_max_size_or_null(max_runs)), _options(options)
+	{
+		if(!_buffer.data() || !_runs.data())
+			*this = sorted_ovector();
+	}
+
+	// first element in [first, first + n) that is not less than key, with a conditional move instead of a branch
+	T const* lower_bound(T const* first, size_type n, T const& key) const
+	{
+		if(n == 0)
+			return first;
+
+		while(n > 1)
+		{
+			auto half = n / 2;
+			first = _compare(first[half], key) ? first + half : first;
+			n -= half;
+		}
+
+		return first + _compare(*first, key);
+	}
+
+	// first element in [first, first + n) that is greater than key
+	T const* upper_bound(T const* first, size_type n, T const& key) const
+	{
+		if(n == 0)
+			return first;
+
+		while(n > 1)
+		{
+			auto half = n / 2;
+			first = _compare(key, first[half]) ? first : first + half;
+			n -= half;
+		}
+
+		return first + !_compare(key, *first);
+	}
+
+	// for integers ordered by std::less, equivalence is equality, which the vectorized kernels can search for
+	using buffer_kernels = std::integral_constant<bool, detail::has_kernels<T>::value && std::is_integral<T>::value
+	                                                    && std::is_same<Compare, std::less<T>>::value>;
+
+	OVECTOR_FORCE_INLINE
+	T const* find_in_buffer(T const& key, std::true_type) const noexcept
+	{
+		auto i = detail::find(_buffer.data(), _buffer.size(), key, std::true_type());
+		return i != _buffer.size() ? _buffer.data() + i : nullptr;
+	}
+
+	T const* find_in_buffer(T const& key, std::false_type) const
+	{
+		for(auto& value : _buffer)
+			if(!_compare(value, key) && !_compare(key, value))
+				return &value;
+
+		return nullptr;
+	}
+
+	OVECTOR_FORCE_INLINE
+	size_type count_in_buffer(T const& key, std::true_type) const noexcept
+	{
+		return detail::count(_buffer.data(), _buffer.size(), key, std::true_type());
+	}
+
+	size_type count_in_buffer(T const& key, std::false_type) const
+	{
+		size_type n = 0;
+
+		for(auto& value : _buffer)
+			n += !_compare(value, key) && !_compare(key, value);
+
+		return n;
+	}
+
+	// passes the elements of k sorted ranges to sink in ascending order, taking them from the earliest range on ties
+	template <typename F>
+	void merge_cursors(cursor* cursors, size_type k, F& sink)
+	{
+		for(;;)
+		{
+			auto best = k;
+
+			for(size_type i = 0; i != k; ++i)
+			{
+				if(cursors[i].next != cursors[i].end
+				   && (best == k || _compare(*cursors[i].next, *cursors[best].next)))
+					best = i;
+			}
+
+			if(best == k)
+				return;
+
+			sink(*cursors[best].next++);
+		}
+	}
+
+	// merges the runs from index first to the newest one into a single run of the given tier
+	bool merge(size_type first, size_type tier)
+	{
+		size_type n = 0;
+
+		for(auto i = first; i != _runs.size(); ++i)
+			n += _runs[i].elements.size();
+
+		auto merged = ovector<T>::with_max_size_or_null(n, _options);
+
+		if(!merged.data())
+			return false;
+
+		cursor cursors[max_runs];
+		size_type k = 0;
+
+		for(auto i = first; i != _runs.size(); ++i)
+			cursors[k++] = cursor{_runs[i].elements.begin(), _runs[i].elements.end()};
+
+		auto sink = [&merged](T& value) { merged.push_back(detail::inlined_move(value)); };
+		merge_cursors(cursors, k, sink);
+
+		while(_runs.size() != first)
+			_runs.pop_back();
+
+		_runs.push_back(run{detail::inlined_move(merged), tier});
+		return true;
+	}
+
+	// size-tiered compaction: merges the newest runs while there are fanout of them in the same tier
+	void merge_tiers()
+	{
+		while(_runs.size() >= fanout)
+		{
+			auto first = _runs.size() - fanout;
+			auto tier = _runs[first].tier;
+
+			for(auto i = first + 1; i != _runs.size(); ++i)
+				if(_runs[i].tier != tier)
+					return;
+
+			// the runs stay as they are without memory for the merge, lookups just have more runs to search
+			if(!merge(first, tier + 1))
+				return;
+		}
+	}
+
+public:
+	/**
+	 * Construct a @c sorted_ovector without backing storage.
+	 * @post @code buffer_size() == 0 @endcode
+	 */
+	sorted_ovector() noexcept = default;
+
+	sorted_ovector(sorted_ovector&& other) noexcept
+		: _buffer(detail::inlined_move(other._buffer)), _runs(detail::inlined_move(other._runs)),
+		  _sealed(detail::inlined_exchange(other._sealed, 0)), _options(other._options), _compare(other._compare)
+	{}
+
+	sorted_ovector& operator=(sorted_ovector&& other) noexcept
+	{
+		_buffer = detail::inlined_move(other._buffer);
+		_runs = detail::inlined_move(other._runs);
+		_sealed = detail::inlined_exchange(other._sealed, 0);
+		_options = other._options;
+		_compare = other._compare;
+		return *this;
+	}
+
+	/**
+	 * Create a new @c sorted_ovector.
+	 * @param buffer_size The number of elements appended before they are sealed into a sorted run. Lookups scan
+	 * the buffer, and every run is a separate reservation, so around a thousand elements balance the cost of
+	 * scanning against the cost of sealing and merging.
+	 * @return The newly created @c sorted_ovector. @c buffer_size() returns 0 if the allocation failed.
+	 */
+	OVECTOR_NODISCARD
+	static
+	sorted_ovector with_buffer_size_or_null(size_type buffer_size) noexcept
+	{
+		return sorted_ovector(buffer_size, ovector_options());
+	}
+
+	/**
+	 * Create a new @c sorted_ovector with given storage options.
+	 * @copydetails with_buffer_size_or_null(size_type)
+	 * @param options Options for the storage of the buffer and of every run.
+	 */
+	OVECTOR_NODISCARD
+	static
+	sorted_ovector with_buffer_size_or_null(size_type buffer_size, ovector_options const& options) noexcept
+	{
+		return sorted_ovector(buffer_size, options);
+	}
+
+	/**
+	 * Get the number of elements.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type size() const noexcept
+	{
+		return _sealed + _buffer.size();
+	}
+
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Get the number of elements appended before they are sealed into a sorted run.
+	 * @return The size of the buffer, or @c 0 if this @c sorted_ovector is not backed by storage.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type buffer_size() const noexcept
+	{
+		return _buffer.max_size();
+	}
+
+	/**
+	 * Get the number of sealed runs, each of which a lookup searches.
+	 */
+	OVECTOR_NODISCARD
+	OVECTOR_FORCE_INLINE
+	size_type run_count() const noexcept
+	{
+		return _runs.size();
+	}
+
+	/**
+	 * Insert an element. Seals the buffer first if it is full.
+	 * @pre @code buffer_size() != 0 @endcode
+	 * @return false if there was no memory for sealing the buffer, in which case the element was not inserted.
+	 * @note Complexity: amortized O(log(size() / buffer_size())) element moves, O(1) if the buffer is not full.
+	 */
+	bool insert(T value)
+	{
+		assert(buffer_size() != 0);
+
+		if(_buffer.size() == _buffer.max_size() && !seal())
+			return false;
+
+		_buffer.push_back(detail::inlined_move(value));
+		return true;
+	}
+
+	/**
+	 * Sort the buffer into a new run and merge the newest runs as long as there are @c fanout of them in the same
+	 * tier. Does nothing if the buffer is empty.
+	 * @return false if there was no memory for the new run, in which case nothing changed.
+	 * @note Invalidates pointers to the elements in the buffer and in the merged runs.
+	 */
+	bool seal()
+	{
+		auto n = _buffer.size();
+
+		if(n == 0)
+			return true;
+
+		if(_runs.size() == _runs.max_size())
+			return false;
+
+		auto elements = ovector<T>::with_max_size_or_null(n, _options);
+
+		if(!elements.data())
+			return false;
+
+		std::sort(_buffer.begin(), _buffer.end(), _compare);
+
+		for(auto& value : _buffer)
+			elements.push_back(detail::inlined_move(value));
+
+		_buffer.clear();
+		_runs.push_back(run{detail::inlined_move(elements), 0});
+		_sealed += n;
+		merge_tiers();
+		return true;
+	}
+
+	/**
+	 * Seal the buffer and merge all runs into one, which makes lookups a single binary search.
+	 * @return false if there was no memory for the merged run, in which case the runs stay as they are.
+	 * @note Invalidates all pointers to elements.
+	 * @note Complexity: O(size() * run_count()) comparisons.
+	 */
+	bool compact()
+	{
+		if(!seal())
+			return false;
+
+		if(_runs.size() <= 1)
+			return true;
+
+		// the oldest run has the highest tier
+		return merge(0, _runs[0].tier);
+	}
+
+	/**
+	 * Find an element equivalent to @p key.
+	 * @return A pointer to such an element, or @c nullptr if there is none. A pointer into a sealed run stays valid
+	 * until the run is merged, a pointer into the buffer until the buffer is sealed.
+	 * @note Complexity: O(buffer_size()) comparisons for the buffer and O(log(run size)) for each run. The buffer
+	 * is searched with the vectorized kernels of @c mgrech::find for integers ordered by @c std::less.
+	 */
+	OVECTOR_NODISCARD
+	T const* find(T const& key) const
+	{
+		if(auto p = find_in_buffer(key, buffer_kernels()))
+			return p;
+
+		for(auto i = _runs.size(); i-- != 0;)
+		{
+			auto& elements = _runs[i].elements;
+			auto p = lower_bound(elements.data(), elements.size(), key);
+
+			if(p != elements.end() && !_compare(key, *p))
+				return p;
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Check whether there is an element equivalent to @p key.
+	 * @see @c find
+	 */
+	OVECTOR_NODISCARD
+	bool contains(T const& key) const
+	{
+		return find(key) != nullptr;
+	}
+
+	/**
+	 * Get the number of elements equivalent to @p key.
+	 * @note Complexity: O(buffer_size()) comparisons for the buffer and O(log(run size)) for each run.
+	 */
+	OVECTOR_NODISCARD
+	size_type count(T const& key) const
+	{
+		auto n = count_in_buffer(key, buffer_kernels());
+
+		for(auto& r : _runs)
+		{
+			auto first = r.elements.data();
+			auto size = r.elements.size();
+			n += (size_type)(upper_bound(first, size, key) - lower_bound(first, size, key));
+		}
+
+		return n;
+	}
+
+	/**
+	 * Invoke @c f(value) for every element in ascending order, without merging the runs. Sorts the buffer in place,
+	 * which invalidates pointers into it.
+	 * @note Complexity: O(size() * run_count()) comparisons.
+	 */
+	template <typename F>
+	void for_each(F f)
+	{
+		std::sort(_buffer.begin(), _buffer.end(), _compare);
+
+		cursor cursors[max_runs + 1];
+		size_type k = 0;
+
+		for(auto& r : _runs)
+			cursors[k++] = cursor{r.elements.begin(), r.elements.end()};
+
+		cursors[k++] = cursor{_buffer.begin(), _buffer.end()};
+
+		auto sink = [&f](T& value) { f(static_cast<T const&>(value)); };
+		merge_cursors(cursors, k, sink);
+	}
+
+	OVECTOR_FORCE_INLINE
+	void swap(sorted_ovector& other) noexcept
+	{
+		_buffer.swap(other._buffer);
+		_runs.swap(other._runs);
+		detail::inlined_swap(_sealed, other._sealed);
+		detail::inlined_swap(_options, other._options);
+		detail::inlined_swap(_compare, other._compare);
+	}
+};
+
+template <typename T, typename Compare>
+OVECTOR_FORCE_INLINE
+void swap(sorted_ovector<T, Compare>& lhs, sorted_ovector<T, Compare>& rhs) noexcept
+{
+	lhs.swap(rhs);
 }
 
 } // namespace mgrech
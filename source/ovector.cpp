@@ -12,13 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <cstdio>
 #include <exception>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
 #ifdef _WIN32
 #define OVECTOR_WINDOWS
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define OVECTOR_X86
+#endif
+
+#ifdef __linux__
+#define OVECTOR_LINUX
+#endif
+
 #ifdef OVECTOR_WINDOWS
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -26,9 +39,37 @@
 #include <cerrno>
 #include <cstring>
 
+#include <atomic>
+#include <csignal>
+#include <unordered_map>
+#include <vector>
+
 #include <sys/mman.h>
 #endif
 
+#ifdef OVECTOR_LINUX
+#include <climits>
+
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <linux/userfaultfd.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef OVECTOR_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
 #include "ovector.hpp"
 
 using namespace mgrech::detail;
@@ -40,22 +81,26 @@ using namespace mgrech::detail;
 namespace
 {
 
-constexpr size_type PAGE_SIZE = 4096;
+constexpr size_type PAGE_SIZE = page_size;
 constexpr size_type SIZE_TYPE_MAX = ~size_type();
 
-OVECTOR_FORCE_INLINE
+// fills the bytes between the end of the data and the guard page, which an alignment leaves unprotected
+constexpr unsigned char CANARY = 0xa5;
+
+inline OVECTOR_FORCE_INLINE
 size_type ceil_multiple(size_type size, size_type n)
 {
 	return (size / n + (size % n != 0)) * n;
 }
 
-OVECTOR_FORCE_INLINE
+inline OVECTOR_FORCE_INLINE
 bool add_overflows(size_type a, size_type b)
 {
 	return SIZE_TYPE_MAX - b < a;
 }
 
 int os_last_error();
+void os_dealloc(void* memory, size_type size);
 
 [[noreturn]]
 void fatal_error(char const* location, char const* message)
@@ -68,9 +113,38 @@ void fatal_error(char const* location, char const* message)
 
 #ifdef OVECTOR_WINDOWS
 
-void* os_guarded_alloc(size_type dataSize, size_type guardSize)
+// reservations are aligned to the allocation granularity of 64 KiB. for larger alignments, probe for a free range
+// large enough to contain an aligned one and try to reserve that, which fails if another thread got there first.
+void* os_reserve(size_type size, size_type alignment)
+{
+	if(alignment <= 64 * 1024)
+		return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+
+	if(add_overflows(size, alignment))
+		return nullptr;
+
+	for(int attempt = 0; attempt != 16; ++attempt)
+	{
+		auto probe = VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+
+		if(!probe)
+			return nullptr;
+
+		auto aligned = (void*)ceil_multiple((std::uintptr_t)probe, alignment);
+
+		if(!VirtualFree(probe, 0, MEM_RELEASE))
+			fatal_error(OV_HERE, "failed to release memory");
+
+		if(auto memory = VirtualAlloc(aligned, size, MEM_RESERVE, PAGE_NOACCESS))
+			return memory;
+	}
+
+	return nullptr;
+}
+
+void* os_guarded_alloc(size_type dataSize, size_type guardSize, size_type alignment)
 {
-	auto memory = VirtualAlloc(nullptr, dataSize + guardSize, MEM_RESERVE, PAGE_NOACCESS);
+	auto memory = os_reserve(dataSize + guardSize, alignment);
 
 	if(!memory)
 		return nullptr;
@@ -89,6 +163,12 @@ void os_dealloc(void* memory, size_type size)
 		fatal_error(OV_HERE, "failed to release memory");
 }
 
+void os_discard(void* memory, size_type size)
+{
+	if(!VirtualFree(memory, size, MEM_DECOMMIT) || !VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE))
+		fatal_error(OV_HERE, "failed to discard memory");
+}
+
 int os_last_error()
 {
 	return (int)GetLastError();
@@ -96,13 +176,45 @@ int os_last_error()
 
 #else
 
-void* os_guarded_alloc(size_type dataSize, size_type guardSize)
+// maps size bytes with the given protection, aligned to a multiple of alignment by mapping more than needed and
+// unmapping the excess at both ends
+void* os_map_aligned(size_type size, size_type alignment, int protection, int flags)
 {
-	auto memory = mmap(nullptr, dataSize + guardSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	auto extra = alignment > PAGE_SIZE ? alignment - PAGE_SIZE : 0;
+
+	if(add_overflows(size, extra))
+		return nullptr;
+
+	auto memory = (char*)mmap(nullptr, size + extra, protection, flags, -1, 0);
 
 	if(memory == MAP_FAILED)
 		return nullptr;
 
+	if(extra == 0)
+		return memory;
+
+	auto aligned = (char*)ceil_multiple((std::uintptr_t)memory, alignment);
+	auto head = (size_type)(aligned - memory);
+
+	if(head != 0)
+		os_dealloc(memory, head);
+
+	if(extra != head)
+		os_dealloc(aligned + size, extra - head);
+
+	return aligned;
+}
+
+void* os_guarded_alloc(size_type dataSize, size_type guardSize, size_type alignment)
+{
+	// without MAP_NORESERVE, linux refuses reservations larger than the available memory in its default overcommit
+	// mode, even though only the touched pages are ever backed by memory
+	auto memory = os_map_aligned(dataSize + guardSize, alignment, PROT_READ | PROT_WRITE,
+	                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE);
+
+	if(!memory)
+		return nullptr;
+
 	if(mmap((char*)memory + dataSize, guardSize, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
 		fatal_error(OV_HERE, "failed to enable guard page");
 
@@ -115,6 +227,12 @@ void os_dealloc(void* memory, size_type size)
 		fatal_error(OV_HERE, "failed to unmap memory");
 }
 
+void os_discard(void* memory, size_type size)
+{
+	if(madvise(memory, size, MADV_DONTNEED) == -1)
+		fatal_error(OV_HERE, "failed to discard memory");
+}
+
 int os_last_error()
 {
 	return errno;
@@ -122,37 +240,2755 @@ int os_last_error()
 
 #endif
 
-} // namespace
+#ifdef OVECTOR_LINUX
 
-void* mgrech::detail::guarded_alloc(size_type requestedDataSize, size_type requestedGuardSize)
+// a snapshot that still reads the pages it has not copied from the backing file
+struct memfd_snapshot
 {
-	if(requestedDataSize == 0)
+	char* memory;
+	size_type length;
+};
+
+// allocations made with ovector_options::snapshots, keyed by the start of the allocation
+struct memfd_storage
+{
+	int fd;
+	// the prefix of the storage mapped from the file, 0 before the first snapshot and anonymous memory beyond
+	size_type frozenSize;
+	// snapshots that must copy a page before the file changes there
+	std::vector<memfd_snapshot> snapshots;
+};
+
+std::atomic<size_type> memfdStorageCount(0);
+
+std::mutex& memfd_registry_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::unordered_map<void*, memfd_storage>& memfd_registry()
+{
+	static std::unordered_map<void*, memfd_storage> registry;
+	return registry;
+}
+
+void* os_snapshot_alloc(size_type dataSize, size_type guardSize, size_type alignment)
+{
+	auto fd = memfd_create("ovector", MFD_CLOEXEC);
+
+	if(fd == -1)
 		return nullptr;
 
-	// if rounding up to a page size multiple would overflow
-	if(requestedDataSize > SIZE_TYPE_MAX - PAGE_SIZE + 1 || requestedGuardSize > SIZE_TYPE_MAX - PAGE_SIZE + 1)
+	if(ftruncate(fd, (off_t)dataSize) == -1)
+	{
+		close(fd);
 		return nullptr;
+	}
 
-	auto allocatedDataSize = ceil_multiple(requestedDataSize, PAGE_SIZE);
-	auto allocatedGuardSize = ceil_multiple(requestedGuardSize, PAGE_SIZE);
+	// reserve the address space for data and guard, then map the file over the data part
+	auto memory = os_map_aligned(dataSize + guardSize, alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE);
 
-	if(add_overflows(allocatedDataSize, allocatedGuardSize))
+	if(!memory)
+	{
+		close(fd);
 		return nullptr;
+	}
 
-	auto memory = os_guarded_alloc(allocatedDataSize, allocatedGuardSize);
+	if(mmap(memory, dataSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		os_dealloc(memory, dataSize + guardSize);
+		close(fd);
+		return nullptr;
+	}
 
-	if(!memory)
+	std::lock_guard<std::mutex> lock(memfd_registry_mutex());
+	memfd_registry()[memory] = memfd_storage{fd, 0, {}};
+	++memfdStorageCount;
+	return memory;
+}
+
+void os_snapshot_release(void* memory)
+{
+	if(memfdStorageCount == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(memfd_registry_mutex());
+	auto& registry = memfd_registry();
+	auto it = registry.find(memory);
+
+	if(it == registry.end())
+		return;
+
+	close(it->second.fd);
+	registry.erase(it);
+	--memfdStorageCount;
+}
+
+void os_snapshot_dealloc(void* snapshot, size_type length)
+{
+	if(memfdStorageCount != 0)
+	{
+		std::lock_guard<std::mutex> lock(memfd_registry_mutex());
+
+		for(auto& entry : memfd_registry())
+		{
+			auto& snapshots = entry.second.snapshots;
+
+			for(auto it = snapshots.begin(); it != snapshots.end(); ++it)
+			{
+				if(it->memory == snapshot)
+				{
+					snapshots.erase(it);
+					break;
+				}
+			}
+		}
+	}
+
+	os_dealloc(snapshot, length);
+}
+
+// pagemap entry bits, see Documentation/admin-guide/mm/pagemap.rst
+constexpr std::uint64_t PAGEMAP_PRESENT = 1ull << 63;
+constexpr std::uint64_t PAGEMAP_SWAPPED = 1ull << 62;
+constexpr std::uint64_t PAGEMAP_FILE    = 1ull << 61;
+
+// calls f(offset, size) for each run of pages of memory that are no longer backed by the file, i.e. private copies
+// and anonymous pages, and stops at the first call returning false. every page counts as modified if the page
+// tables cannot be read.
+template <typename F>
+bool for_each_modified_run(char const* memory, size_type length, F f)
+{
+	auto fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+	if(fd == -1)
+		return f(0, length);
+
+	constexpr size_type BATCH = 512;
+	std::uint64_t entries[BATCH];
+	auto pages = length / PAGE_SIZE;
+	size_type runBegin = 0;
+	size_type runEnd = 0;
+	auto result = true;
+
+	for(size_type first = 0; first < pages && result; first += BATCH)
+	{
+		auto n = pages - first < BATCH ? pages - first : BATCH;
+		auto offset = ((std::uintptr_t)memory / PAGE_SIZE + first) * sizeof(std::uint64_t);
+		auto bytes = n * sizeof(std::uint64_t);
+		auto known = pread(fd, entries, bytes, (off_t)offset) == (ssize_t)bytes;
+
+		for(size_type i = 0; i != n && result; ++i)
+		{
+			auto entry = entries[i];
+
+			if(known && !(entry & PAGEMAP_SWAPPED) && (!(entry & PAGEMAP_PRESENT) || (entry & PAGEMAP_FILE)))
+				continue;
+
+			auto page = (first + i) * PAGE_SIZE;
+
+			if(page != runEnd)
+			{
+				if(runEnd != runBegin)
+					result = f(runBegin, runEnd - runBegin);
+
+				runBegin = page;
+			}
+
+			runEnd = page + PAGE_SIZE;
+		}
+	}
+
+	if(result && runEnd != runBegin)
+		result = f(runBegin, runEnd - runBegin);
+
+	close(fd);
+	return result;
+}
+
+// makes the snapshots copy the pages in [offset, offset + size) that they still read from the file
+bool detach_snapshots(std::vector<memfd_snapshot> const& snapshots, size_type offset, size_type size)
+{
+	for(auto& snapshot : snapshots)
+	{
+		if(offset >= snapshot.length)
+			continue;
+
+		auto begin = snapshot.memory + offset;
+		auto end = snapshot.memory + (offset + size < snapshot.length ? offset + size : snapshot.length);
+
+		if(mprotect(begin, (size_type)(end - begin), PROT_READ | PROT_WRITE) == -1)
+			return false;
+
+		for(auto p = (char volatile*)begin; p < end; p += PAGE_SIZE)
+			*p = *p;
+
+		if(mprotect(begin, (size_type)(end - begin), PROT_READ) == -1)
+			return false;
+	}
+
+	return true;
+}
+
+bool write_all(int fd, char const* data, size_type size, size_type offset)
+{
+	while(size != 0)
+	{
+		auto written = pwrite(fd, data, size, (off_t)offset);
+
+		if(written == -1 && errno == EINTR)
+			continue;
+
+		if(written <= 0)
+			return false;
+
+		data += written;
+		size -= (size_type)written;
+		offset += (size_type)written;
+	}
+
+	return true;
+}
+
+// writes the pages of the storage modified since the last snapshot back to the file and maps them from there again,
+// so that the file matches the first length bytes of the storage and the next snapshot only finds the pages
+// modified after this one
+bool refreeze(memfd_storage& storage, char* memory, size_type length)
+{
+	auto frozenSize = storage.frozenSize;
+
+	auto written = for_each_modified_run(memory, length, [&](size_type offset, size_type size)
+	{
+		if(!detach_snapshots(storage.snapshots, offset, size) || !write_all(storage.fd, memory + offset, size, offset))
+			return false;
+
+		if(offset >= frozenSize)
+			return true;
+
+		auto end = offset + size < frozenSize ? offset + size : frozenSize;
+
+		if(mmap(memory + offset, end - offset, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, storage.fd,
+		        (off_t)offset) == MAP_FAILED)
+			fatal_error(OV_HERE, "failed to remap storage for snapshot");
+
+		return true;
+	});
+
+	if(!written)
+		return false;
+
+	// the anonymous pages up to length are in the file now, or zero on both sides
+	if(length > frozenSize)
+	{
+		if(mmap(memory + frozenSize, length - frozenSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, storage.fd,
+		        (off_t)frozenSize) == MAP_FAILED)
+			fatal_error(OV_HERE, "failed to remap storage for snapshot");
+
+		storage.frozenSize = length;
+	}
+
+	return true;
+}
+
+// the canary from canaryOffset to dataSize survives the remapping of the storage
+void* os_snapshot(void* memory, size_type dataSize, size_type canaryOffset, size_type length)
+{
+	std::lock_guard<std::mutex> lock(memfd_registry_mutex());
+	auto& registry = memfd_registry();
+	auto it = registry.find(memory);
+
+	if(it == registry.end())
 		return nullptr;
 
-	auto wastedSpace = allocatedDataSize - requestedDataSize;
-	return (char*)memory + wastedSpace;
+	auto& storage = it->second;
+
+	if(storage.frozenSize == 0)
+	{
+		// freeze the file: from now on the ovector writes to private copies of the pages and the file only
+		// changes when a later snapshot writes them back. beyond the snapshot the ovector switches to anonymous
+		// memory so that pages appended later are not also allocated in the file, and the file drops what was
+		// written there before.
+		if(mmap(memory, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, storage.fd, 0) == MAP_FAILED)
+			fatal_error(OV_HERE, "failed to remap storage for snapshot");
+
+		if(length != dataSize)
+		{
+			if(mmap((char*)memory + length, dataSize - length, PROT_READ | PROT_WRITE,
+			        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+				fatal_error(OV_HERE, "failed to remap storage for snapshot");
+
+			auto stale = (off_t)(dataSize - length);
+			fallocate(storage.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)length, stale);
+
+			// the canary lies within the last page, which the snapshot does not cover here
+			std::memset((char*)memory + canaryOffset, CANARY, dataSize - canaryOffset);
+		}
+
+		storage.frozenSize = length;
+	}
+	else if(!refreeze(storage, (char*)memory, length))
+		return nullptr;
+
+	auto snapshot = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, storage.fd, 0);
+
+	if(snapshot == MAP_FAILED)
+		return nullptr;
+
+	storage.snapshots.push_back(memfd_snapshot{(char*)snapshot, length});
+	return snapshot;
 }
 
-void mgrech::detail::guarded_dealloc(void* memory, size_type requestedDataSize, size_type requestedGuardSize)
+#else
+
+void* os_snapshot_alloc(size_type dataSize, size_type guardSize, size_type alignment)
 {
-	auto allocatedDataSize = ceil_multiple(requestedDataSize, PAGE_SIZE);
-	auto allocatedGuardSize = ceil_multiple(requestedGuardSize, PAGE_SIZE);
-	auto wastedSpace = allocatedDataSize - requestedDataSize;
-	auto allocatedMemory = (char*)memory - wastedSpace;
-	os_dealloc(allocatedMemory, allocatedDataSize + allocatedGuardSize);
+	return os_guarded_alloc(dataSize, guardSize, alignment);
+}
+
+void os_snapshot_release(void* memory)
+{
+	(void)memory;
+}
+
+void os_snapshot_dealloc(void* snapshot, size_type length)
+{
+	os_dealloc(snapshot, length);
+}
+
+void* os_snapshot(void* memory, size_type dataSize, size_type canaryOffset, size_type length)
+{
+	(void)memory;
+	(void)dataSize;
+	(void)canaryOffset;
+	(void)length;
+	return nullptr;
+}
+
+#endif
+
+// numa placement
+
+#ifdef OVECTOR_LINUX
+
+long os_mbind(void* memory, size_type size, int mode, std::uint64_t nodes, unsigned flags)
+{
+	unsigned long mask[sizeof(std::uint64_t) / sizeof(unsigned long)];
+	std::memcpy(mask, &nodes, sizeof nodes);
+
+	// the kernel reads one bit less than maxnode
+	auto maxNode = nodes ? sizeof(nodes) * 8 + 1 : 0;
+	return syscall(SYS_mbind, memory, size, mode, nodes ? mask : nullptr, maxNode, flags);
+}
+
+bool os_place(void* memory, size_type size, mgrech::numa_policy policy, std::uint64_t nodes, bool move)
+{
+	unsigned flags = move ? MPOL_MF_MOVE : 0;
+
+	// the kernel intersects the mask with the nodes that have memory and are allowed for the process
+	if(nodes == 0)
+		nodes = ~std::uint64_t();
+
+	switch(policy)
+	{
+	case mgrech::numa_policy::inherit:
+		return os_mbind(memory, size, MPOL_DEFAULT, 0, flags) == 0;
+
+	case mgrech::numa_policy::local:
+		// MPOL_LOCAL needs linux 3.8, preferring no node is equivalent
+		return os_mbind(memory, size, MPOL_LOCAL, 0, flags) == 0 ||
+		       os_mbind(memory, size, MPOL_PREFERRED, 0, flags) == 0;
+
+	case mgrech::numa_policy::interleave:
+		return os_mbind(memory, size, MPOL_INTERLEAVE, nodes, flags) == 0;
+
+	case mgrech::numa_policy::bind:
+		return os_mbind(memory, size, MPOL_BIND, nodes, flags) == 0;
+	}
+
+	return false;
+}
+
+#else
+
+bool os_place(void* memory, size_type size, mgrech::numa_policy policy, std::uint64_t nodes, bool move)
+{
+	(void)memory;
+	(void)size;
+	(void)policy;
+	(void)nodes;
+	(void)move;
+	return false;
+}
+
+#endif
+
+// access hints and demotion
+
+#ifndef OVECTOR_WINDOWS
+
+#ifdef OVECTOR_LINUX
+// missing from headers before linux 5.4
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+#endif
+
+bool os_advise(void* memory, size_type size, page_advice advice)
+{
+	int value = -1;
+
+	switch(advice)
+	{
+	case page_advice::normal:      value = MADV_NORMAL; break;
+	case page_advice::sequential:  value = MADV_SEQUENTIAL; break;
+	case page_advice::random:      value = MADV_RANDOM; break;
+	case page_advice::will_need:   value = MADV_WILLNEED; break;
+#ifdef OVECTOR_LINUX
+	case page_advice::cold:        value = MADV_COLD; break;
+	case page_advice::pageout:     value = MADV_PAGEOUT; break;
+	case page_advice::small_pages: value = MADV_NOHUGEPAGE; break;
+#else
+	case page_advice::cold:
+	case page_advice::pageout:
+	case page_advice::small_pages: break;
+#endif
+	}
+
+	return value != -1 && madvise(memory, size, value) == 0;
+}
+
+// allocations made with ovector_options::demote_behind_pages, keyed by the start of the allocation
+struct demoted_storage
+{
+	size_type pagesBehind;
+	// end of the prefix marked cold so far
+	size_type demotedEnd;
+};
+
+std::atomic<size_type> demotedStorageCount(0);
+
+std::mutex& demoted_registry_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::unordered_map<void*, demoted_storage>& demoted_registry()
+{
+	static std::unordered_map<void*, demoted_storage> registry;
+	return registry;
+}
+
+void os_register_demotion(void* memory, size_type pagesBehind)
+{
+	// the kernel rejects unknown advice before looking at the range, so an empty one tells whether MADV_COLD exists
+	if(!os_advise(memory, 0, page_advice::cold))
+		return;
+
+	std::lock_guard<std::mutex> lock(demoted_registry_mutex());
+	demoted_registry()[memory] = demoted_storage{pagesBehind, 0};
+	++demotedStorageCount;
+}
+
+void os_unregister_demotion(void* memory)
+{
+	if(demotedStorageCount == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(demoted_registry_mutex());
+
+	if(demoted_registry().erase(memory))
+		--demotedStorageCount;
+}
+
+// returns false if demotion is off for the allocation
+bool os_demote(void* memory, size_type usedEnd)
+{
+	if(demotedStorageCount == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(demoted_registry_mutex());
+	auto& registry = demoted_registry();
+	auto it = registry.find(memory);
+
+	if(it == registry.end())
+		return false;
+
+	auto& storage = it->second;
+	auto behind = storage.pagesBehind * PAGE_SIZE;
+	auto tailPage = usedEnd / PAGE_SIZE * PAGE_SIZE;
+	auto end = tailPage > behind ? tailPage - behind : 0;
+
+	// the ovector was cleared, the pages it refills are demoted again
+	if(end < storage.demotedEnd)
+		storage.demotedEnd = end;
+
+	auto batch = storage.pagesBehind / 4 ? storage.pagesBehind / 4 * PAGE_SIZE : PAGE_SIZE;
+
+	if(end >= storage.demotedEnd + batch)
+	{
+		// without MADV_COLD there is nothing to do, now or later
+		if(!os_advise((char*)memory + storage.demotedEnd, end - storage.demotedEnd, page_advice::cold))
+		{
+			registry.erase(it);
+			--demotedStorageCount;
+			return false;
+		}
+
+		storage.demotedEnd = end;
+	}
+
+	return true;
+}
+
+#else
+
+bool os_advise(void* memory, size_type size, page_advice advice)
+{
+	(void)memory;
+	(void)size;
+	(void)advice;
+	return false;
+}
+
+void os_register_demotion(void* memory, size_type pagesBehind)
+{
+	(void)memory;
+	(void)pagesBehind;
+}
+
+void os_unregister_demotion(void* memory)
+{
+	(void)memory;
+}
+
+bool os_demote(void* memory, size_type usedEnd)
+{
+	(void)memory;
+	(void)usedEnd;
+	return false;
+}
+
+#endif
+
+// fork policies
+
+#ifdef OVECTOR_LINUX
+// missing from headers before linux 4.14
+#ifndef MADV_WIPEONFORK
+#define MADV_WIPEONFORK 18
+#endif
+
+// allocations made with a fork policy other than inherit, keyed by the start of the allocation
+struct forked_storage
+{
+	size_type dataSize;
+	size_type guardSize;
+	// start of the canary relative to the allocation
+	size_type canaryOffset;
+	// the allocation is not mapped into children at all
+	bool dontFork;
+};
+
+std::atomic<size_type> forkedStorageCount(0);
+
+std::mutex& forked_registry_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::unordered_map<void*, forked_storage>& forked_registry()
+{
+	static std::unordered_map<void*, forked_storage> registry;
+	return registry;
+}
+
+void lock_forked_registry()
+{
+	forked_registry_mutex().lock();
+}
+
+void unlock_forked_registry()
+{
+	forked_registry_mutex().unlock();
+}
+
+// the child has no memory where the allocations that were not inherited used to be and zeroes where the wiped ones
+// are. map fresh memory in place of the former and restore the canaries of both, so that they can be reused and
+// released like any other allocation.
+void restore_forked_storage()
+{
+	for(auto& entry : forked_registry())
+	{
+		auto memory = (char*)entry.first;
+		auto& storage = entry.second;
+
+		if(storage.dontFork)
+		{
+			if(mmap(memory, storage.dataSize, PROT_READ | PROT_WRITE,
+			        MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) == MAP_FAILED
+			   || mmap(memory + storage.dataSize, storage.guardSize, PROT_NONE,
+			           MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+				fatal_error(OV_HERE, "failed to map memory after fork");
+
+			// children of the child do not inherit it either
+			madvise(memory, storage.dataSize + storage.guardSize, MADV_DONTFORK);
+		}
+
+		std::memset(memory + storage.canaryOffset, CANARY, storage.dataSize - storage.canaryOffset);
+	}
+
+	unlock_forked_registry();
+}
+
+void os_register_fork(void* memory, size_type dataSize, size_type guardSize, size_type canaryOffset,
+                      mgrech::fork_policy policy)
+{
+	if(policy == mgrech::fork_policy::inherit)
+		return;
+
+	// the registry is locked across fork, so that the child sees it in a consistent state
+	static int const atfork = pthread_atfork(lock_forked_registry, unlock_forked_registry, restore_forked_storage);
+	(void)atfork;
+
+	auto size = dataSize + guardSize;
+	auto dontFork = policy == mgrech::fork_policy::dont_fork || madvise(memory, size, MADV_WIPEONFORK) == -1;
+
+	if(dontFork && madvise(memory, size, MADV_DONTFORK) == -1)
+		return;
+
+	std::lock_guard<std::mutex> lock(forked_registry_mutex());
+	forked_registry()[memory] = forked_storage{dataSize, guardSize, canaryOffset, dontFork};
+	++forkedStorageCount;
+}
+
+void os_unregister_fork(void* memory)
+{
+	if(forkedStorageCount == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(forked_registry_mutex());
+
+	if(forked_registry().erase(memory))
+		--forkedStorageCount;
+}
+
+#else
+
+void os_register_fork(void* memory, size_type dataSize, size_type guardSize, size_type canaryOffset,
+                      mgrech::fork_policy policy)
+{
+	(void)memory;
+	(void)dataSize;
+	(void)guardSize;
+	(void)canaryOffset;
+	(void)policy;
+}
+
+void os_unregister_fork(void* memory)
+{
+	(void)memory;
+}
+
+#endif
+
+// dirty page tracking
+
+// collects the ranges reported by the tracking mechanisms, clamps them to the used part of the allocation and merges
+// adjacent ones before passing them on relative to the start of the data
+struct dirty_reporter
+{
+	dirty_range_callback callback;
+	void* context;
+	size_type dataOffset;
+	size_type usedEnd;
+	size_type pendingFirst;
+	size_type pendingLast;
+
+	void add(size_type first, size_type last)
+	{
+		if(first < dataOffset)
+			first = dataOffset;
+
+		if(last > usedEnd)
+			last = usedEnd;
+
+		if(first >= last)
+			return;
+
+		if(pendingFirst != pendingLast && first <= pendingLast)
+		{
+			if(last > pendingLast)
+				pendingLast = last;
+
+			return;
+		}
+
+		flush();
+		pendingFirst = first;
+		pendingLast = last;
+	}
+
+	void flush()
+	{
+		if(pendingFirst != pendingLast)
+			callback(context, pendingFirst - dataOffset, pendingLast - dataOffset);
+
+		pendingFirst = pendingLast = 0;
+	}
+};
+
+#ifdef OVECTOR_WINDOWS
+
+void os_track_dirty(void* memory, size_type dataSize, mgrech::dirty_tracking tracking)
+{
+	(void)memory;
+	(void)dataSize;
+	(void)tracking;
+}
+
+void os_untrack_dirty(void* memory)
+{
+	(void)memory;
+}
+
+bool os_collect_dirty(void* memory, size_type usedEnd, dirty_reporter& report)
+{
+	(void)memory;
+	(void)usedEnd;
+	(void)report;
+	return false;
+}
+
+#else
+
+enum class tracking_mechanism
+{
+	userfaultfd,
+	mprotect,
+};
+
+// allocations made with ovector_options::track_dirty_pages, keyed by the start of the allocation
+struct tracked_storage
+{
+	tracking_mechanism mechanism;
+	// index into protectSlots for tracking_mechanism::mprotect
+	size_type slot;
+	// end of the used pages at the previous collection, everything after it was appended since
+	size_type watermark;
+};
+
+std::atomic<size_type> trackedStorageCount(0);
+
+std::mutex& tracked_registry_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::unordered_map<void*, tracked_storage>& tracked_registry()
+{
+	static std::unordered_map<void*, tracked_storage> registry;
+	return registry;
+}
+
+// allocations tracked with mprotect. the signal handler cannot take locks, so a slot is claimed through an atomic
+// flag and published by storing its begin last.
+struct protect_slot
+{
+	std::atomic<bool> claimed;
+	std::atomic<char*> begin;
+	size_type length;
+	// one flag per page, set by the signal handler on the first write after the page was protected
+	std::atomic<unsigned char>* dirty;
+};
+
+constexpr size_type PROTECT_SLOT_COUNT = 64;
+protect_slot protectSlots[PROTECT_SLOT_COUNT];
+
+// write faults are reported as SIGBUS on some systems
+constexpr int PROTECT_SIGNALS[] = {SIGSEGV, SIGBUS};
+struct sigaction previousActions[2];
+
+void chain_signal(int signal, siginfo_t* info, void* context)
+{
+	auto& previous = previousActions[signal == SIGSEGV ? 0 : 1];
+
+	if(previous.sa_flags & SA_SIGINFO)
+	{
+		previous.sa_sigaction(signal, info, context);
+		return;
+	}
+
+	if(previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+	{
+		previous.sa_handler(signal);
+		return;
+	}
+
+	// restore the default action, a faulting instruction faults again on return
+	struct sigaction action = {};
+	action.sa_handler = SIG_DFL;
+	sigaction(signal, &action, nullptr);
+
+	if(info->si_code <= 0)
+		raise(signal);
+}
+
+void protect_signal_handler(int signal, siginfo_t* info, void* context)
+{
+	auto address = (char*)info->si_addr;
+
+	for(auto& slot : protectSlots)
+	{
+		auto begin = slot.begin.load(std::memory_order_acquire);
+
+		if(!begin || address < begin || address >= begin + slot.length)
+			continue;
+
+		// reads never fault and the guard pages are outside the slot, so this is the first write to the page
+		auto page = (size_type)(address - begin) / PAGE_SIZE;
+		slot.dirty[page].store(1, std::memory_order_relaxed);
+
+		if(mprotect(begin + page * PAGE_SIZE, PAGE_SIZE, PROT_READ | PROT_WRITE) == -1)
+			break;
+
+		return;
+	}
+
+	chain_signal(signal, info, context);
+}
+
+bool install_protect_signal_handler()
+{
+	struct sigaction action = {};
+	action.sa_sigaction = &protect_signal_handler;
+	action.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&action.sa_mask);
+
+	for(size_type i = 0; i != 2; ++i)
+		if(sigaction(PROTECT_SIGNALS[i], &action, &previousActions[i]) == -1)
+			return false;
+
+	return true;
+}
+
+bool protect_track(void* memory, size_type dataSize, size_type& slotIndex)
+{
+	static bool const installed = install_protect_signal_handler();
+
+	if(!installed)
+		return false;
+
+	// one byte per page, only the pages of flags that are set are ever populated
+	auto pages = dataSize / PAGE_SIZE;
+	auto dirty = mmap(nullptr, pages, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if(dirty == MAP_FAILED)
+		return false;
+
+	for(size_type i = 0; i != PROTECT_SLOT_COUNT; ++i)
+	{
+		auto& slot = protectSlots[i];
+
+		if(slot.claimed.exchange(true))
+			continue;
+
+		if(mprotect(memory, dataSize, PROT_READ) == -1)
+		{
+			slot.claimed = false;
+			break;
+		}
+
+		slot.length = dataSize;
+		slot.dirty = (std::atomic<unsigned char>*)dirty;
+		slot.begin.store((char*)memory, std::memory_order_release);
+		slotIndex = i;
+		return true;
+	}
+
+	os_dealloc(dirty, pages);
+	return false;
+}
+
+void protect_untrack(size_type slotIndex)
+{
+	auto& slot = protectSlots[slotIndex];
+	slot.begin.store(nullptr, std::memory_order_release);
+	os_dealloc(slot.dirty, slot.length / PAGE_SIZE);
+	slot.claimed = false;
+}
+
+// write-protects [first, last) of an allocation tracked with mprotect
+void protect_pages(protect_slot& slot, size_type first, size_type last)
+{
+	// clear the flags before protecting: a write in between does not fault, but happened before the collection
+	// returns and is reported by it
+	for(auto page = first / PAGE_SIZE; page != last / PAGE_SIZE; ++page)
+		slot.dirty[page].store(0, std::memory_order_relaxed);
+
+	if(mprotect(slot.begin.load(std::memory_order_relaxed) + first, last - first, PROT_READ) == -1)
+		fatal_error(OV_HERE, "failed to write-protect pages");
+}
+
+void protect_collect(protect_slot& slot, size_type length, dirty_reporter& report)
+{
+	auto pages = length / PAGE_SIZE;
+	size_type page = 0;
+
+	while(page != pages)
+	{
+		if(!slot.dirty[page].load(std::memory_order_relaxed))
+		{
+			++page;
+			continue;
+		}
+
+		auto first = page;
+
+		while(page != pages && slot.dirty[page].load(std::memory_order_relaxed))
+			++page;
+
+		protect_pages(slot, first * PAGE_SIZE, page * PAGE_SIZE);
+		report.add(first * PAGE_SIZE, page * PAGE_SIZE);
+	}
+}
+
+#ifdef OVECTOR_LINUX
+
+// userfaultfd write-protection in asynchronous mode (Linux 6.7): the kernel resolves the fault itself by removing
+// the protection and marking the page as written, PAGEMAP_SCAN reports and protects the written pages again in one
+// step. the definitions are missing from older headers.
+constexpr std::uint64_t OV_UFFD_FEATURE_WP_UNPOPULATED = 1 << 13;
+constexpr std::uint64_t OV_UFFD_FEATURE_WP_ASYNC       = 1 << 15;
+constexpr int OV_UFFD_USER_MODE_ONLY                   = 1;
+
+struct ov_page_region
+{
+	std::uint64_t start;
+	std::uint64_t end;
+	std::uint64_t categories;
+};
+
+struct ov_pm_scan_arg
+{
+	std::uint64_t size;
+	std::uint64_t flags;
+	std::uint64_t start;
+	std::uint64_t end;
+	std::uint64_t walk_end;
+	std::uint64_t vec;
+	std::uint64_t vec_len;
+	std::uint64_t max_pages;
+	std::uint64_t category_inverted;
+	std::uint64_t category_mask;
+	std::uint64_t category_anyof_mask;
+	std::uint64_t return_mask;
+};
+
+constexpr std::uint64_t OV_PAGE_IS_WRITTEN       = 1 << 1;
+constexpr std::uint64_t OV_PM_SCAN_WP_MATCHING   = 1 << 0;
+constexpr std::uint64_t OV_PM_SCAN_CHECK_WPASYNC = 1 << 1;
+constexpr unsigned long OV_PAGEMAP_SCAN          = _IOWR('f', 16, ov_pm_scan_arg);
+
+int open_userfaultfd()
+{
+	auto fd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | OV_UFFD_USER_MODE_ONLY);
+
+	if(fd == -1)
+		return -1;
+
+	uffdio_api api = {};
+	api.api = UFFD_API;
+	api.features = OV_UFFD_FEATURE_WP_ASYNC | OV_UFFD_FEATURE_WP_UNPOPULATED;
+
+	if(ioctl(fd, UFFDIO_API, &api) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// one userfaultfd serves all allocations, it is never read from because faults are resolved by the kernel
+int userfaultfd_instance()
+{
+	static int const fd = open_userfaultfd();
+	return fd;
+}
+
+bool userfaultfd_protect(void* memory, size_type length)
+{
+	uffdio_writeprotect protect = {};
+	protect.range.start = (std::uintptr_t)memory;
+	protect.range.len = length;
+	protect.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+	return ioctl(userfaultfd_instance(), UFFDIO_WRITEPROTECT, &protect) != -1;
+}
+
+bool userfaultfd_track(void* memory, size_type dataSize)
+{
+	auto fd = userfaultfd_instance();
+
+	if(fd == -1)
+		return false;
+
+	uffdio_register reg = {};
+	reg.range.start = (std::uintptr_t)memory;
+	reg.range.len = dataSize;
+	reg.mode = UFFDIO_REGISTER_MODE_WP;
+
+	if(ioctl(fd, UFFDIO_REGISTER, &reg) == -1)
+		return false;
+
+	if(!userfaultfd_protect(memory, dataSize))
+	{
+		ioctl(fd, UFFDIO_UNREGISTER, &reg.range);
+		return false;
+	}
+
+	return true;
+}
+
+void userfaultfd_collect(char* memory, size_type length, dirty_reporter& report)
+{
+	if(length == 0)
+		return;
+
+	// opened per call, a descriptor inherited over fork would refer to the page tables of the parent
+	auto fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+	if(fd == -1)
+	{
+		report.add(0, length);
+		return;
+	}
+
+	constexpr size_type BATCH = 64;
+	ov_page_region regions[BATCH];
+
+	ov_pm_scan_arg arg = {};
+	arg.size = sizeof arg;
+	arg.flags = OV_PM_SCAN_WP_MATCHING | OV_PM_SCAN_CHECK_WPASYNC;
+	arg.start = (std::uintptr_t)memory;
+	arg.end = (std::uintptr_t)memory + length;
+	arg.vec = (std::uintptr_t)regions;
+	arg.vec_len = BATCH;
+	arg.category_mask = OV_PAGE_IS_WRITTEN;
+	arg.return_mask = OV_PAGE_IS_WRITTEN;
+
+	for(;;)
+	{
+		auto n = ioctl(fd, OV_PAGEMAP_SCAN, &arg);
+
+		if(n == -1)
+		{
+			report.add(arg.start - (std::uintptr_t)memory, length);
+			break;
+		}
+
+		for(decltype(n) i = 0; i != n; ++i)
+			report.add(regions[i].start - (std::uintptr_t)memory, regions[i].end - (std::uintptr_t)memory);
+
+		if(arg.walk_end >= arg.end)
+			break;
+
+		arg.start = arg.walk_end;
+	}
+
+	close(fd);
+}
+
+#else
+
+bool userfaultfd_track(void* memory, size_type dataSize)
+{
+	(void)memory;
+	(void)dataSize;
+	return false;
+}
+
+bool userfaultfd_protect(void* memory, size_type length)
+{
+	(void)memory;
+	(void)length;
+	return false;
+}
+
+void userfaultfd_collect(char* memory, size_type length, dirty_reporter& report)
+{
+	(void)memory;
+	report.add(0, length);
+}
+
+#endif
+
+void os_track_dirty(void* memory, size_type dataSize, mgrech::dirty_tracking tracking)
+{
+	tracked_storage storage = {tracking_mechanism::userfaultfd, 0, 0};
+
+	if(tracking == mgrech::dirty_tracking::none)
+		return;
+
+	// without tracking every collection reports everything, which is correct, just slow. automatic does not fall
+	// back to mprotect, which would make system calls writing into the storage fail.
+	if(tracking == mgrech::dirty_tracking::automatic)
+	{
+		if(!userfaultfd_track(memory, dataSize))
+			return;
+	}
+	else
+	{
+		if(!protect_track(memory, dataSize, storage.slot))
+			return;
+
+		storage.mechanism = tracking_mechanism::mprotect;
+	}
+
+	std::lock_guard<std::mutex> lock(tracked_registry_mutex());
+	tracked_registry()[memory] = storage;
+	++trackedStorageCount;
+}
+
+void os_untrack_dirty(void* memory)
+{
+	if(trackedStorageCount == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(tracked_registry_mutex());
+	auto& registry = tracked_registry();
+	auto it = registry.find(memory);
+
+	if(it == registry.end())
+		return;
+
+	// unmapping the memory also removes the userfaultfd registration
+	if(it->second.mechanism == tracking_mechanism::mprotect)
+		protect_untrack(it->second.slot);
+
+	registry.erase(it);
+	--trackedStorageCount;
+}
+
+bool os_collect_dirty(void* memory, size_type usedEnd, dirty_reporter& report)
+{
+	if(trackedStorageCount == 0)
+		return false;
+
+	std::lock_guard<std::mutex> lock(tracked_registry_mutex());
+	auto& registry = tracked_registry();
+	auto it = registry.find(memory);
+
+	if(it == registry.end())
+		return false;
+
+	auto& storage = it->second;
+	auto end = ceil_multiple(usedEnd, PAGE_SIZE);
+	auto watermark = storage.watermark < end ? storage.watermark : end;
+
+	if(storage.mechanism == tracking_mechanism::userfaultfd)
+	{
+		userfaultfd_collect((char*)memory, watermark, report);
+
+		// the pages above the watermark are reported without looking, but must be protected for the next call
+		if(watermark != end && !userfaultfd_protect((char*)memory + watermark, end - watermark))
+			fatal_error(OV_HERE, "failed to write-protect pages");
+	}
+	else
+	{
+		auto& slot = protectSlots[storage.slot];
+		protect_collect(slot, watermark, report);
+
+		if(watermark != end)
+			protect_pages(slot, watermark, end);
+	}
+
+	report.add(watermark, end);
+	storage.watermark = end;
+	return true;
+}
+
+#endif
+
+// stream waiting
+
+// streams hash to a bucket holding their suspended coroutines and, without futexes, the condition variable their
+// threads wait on
+struct parking_bucket
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	stream_waiter* waiters = nullptr;
+};
+
+parking_bucket& parking_bucket_for(stream_sync const& sync)
+{
+	static parking_bucket buckets[64];
+	return buckets[(std::uintptr_t)&sync / sizeof(stream_sync) % 64];
+}
+
+#ifdef OVECTOR_LINUX
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word must be a plain integer");
+
+// blocks until the futex word differs from expected, a wakeup, a signal or a timeout in nanoseconds, forever if
+// negative. the caller checks why it returned.
+void os_wait_on(stream_sync& sync, std::uint32_t expected, std::int64_t timeoutNs)
+{
+	timespec timeout = {(time_t)(timeoutNs / 1000000000), (long)(timeoutNs % 1000000000)};
+	syscall(SYS_futex, (std::uint32_t*)&sync.futex, FUTEX_WAIT_PRIVATE, expected, timeoutNs < 0 ? nullptr : &timeout,
+	        nullptr, 0);
+}
+
+void os_wake_all(stream_sync& sync)
+{
+	syscall(SYS_futex, (std::uint32_t*)&sync.futex, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+void os_wait_on(stream_sync& sync, std::uint32_t expected, std::int64_t timeoutNs)
+{
+	auto& bucket = parking_bucket_for(sync);
+	std::unique_lock<std::mutex> lock(bucket.mutex);
+
+	if(sync.futex.load() != expected)
+		return;
+
+	if(timeoutNs < 0)
+		bucket.condition.wait(lock);
+	else
+		bucket.condition.wait_for(lock, std::chrono::nanoseconds(timeoutNs));
+}
+
+void os_wake_all(stream_sync& sync)
+{
+	auto& bucket = parking_bucket_for(sync);
+
+	// a thread that saw the old futex word holds the lock until it waits
+	{
+		std::lock_guard<std::mutex> lock(bucket.mutex);
+	}
+
+	bucket.condition.notify_all();
+}
+
+#endif
+
+// the snapshot covers the pages of the allocation up to the last used byte
+inline OVECTOR_FORCE_INLINE
+size_type snapshot_length(size_type dataOffset, size_type usedSize)
+{
+	auto length = ceil_multiple(dataOffset + usedSize, PAGE_SIZE);
+	return length ? length : PAGE_SIZE;
+}
+
+// the data starts within the first page of the allocation, see guarded_alloc
+inline OVECTOR_FORCE_INLINE
+size_type data_offset(void const* memory)
+{
+	return (std::uintptr_t)memory % PAGE_SIZE;
+}
+
+void check_canary(char const* begin, char const* end)
+{
+	for(auto p = begin; p != end; ++p)
+	{
+		if((unsigned char)*p != CANARY)
+		{
+			std::fprintf(stderr, "%s: fatal error: write past the end of an ovector detected\n", OV_HERE);
+			std::terminate();
+		}
+	}
+}
+
+} // namespace
+
+void* mgrech::detail::guarded_alloc(size_type requestedDataSize, size_type requestedGuardSize,
+                                    mgrech::ovector_options const& options)
+{
+	if(requestedDataSize == 0)
+		return nullptr;
+
+	auto alignment = options.alignment ? options.alignment : 1;
+
+	if(alignment & (alignment - 1))
+		return nullptr;
+
+	// if rounding up to a page size multiple would overflow
+	if(requestedDataSize > SIZE_TYPE_MAX - PAGE_SIZE + 1 || requestedGuardSize > SIZE_TYPE_MAX - PAGE_SIZE + 1)
+		return nullptr;
+
+	auto allocatedDataSize = ceil_multiple(requestedDataSize, PAGE_SIZE);
+	auto allocatedGuardSize = ceil_multiple(requestedGuardSize, PAGE_SIZE);
+
+	if(add_overflows(allocatedDataSize, allocatedGuardSize))
+		return nullptr;
+
+	auto memory = options.snapshots ? os_snapshot_alloc(allocatedDataSize, allocatedGuardSize, alignment)
+	                                : os_guarded_alloc(allocatedDataSize, allocatedGuardSize, alignment);
+
+	if(!memory)
+		return nullptr;
+
+	// move the data as close to the guard page as the alignment allows. alignments of a page or more leave the data
+	// at the start of the allocation, which os_*_alloc aligned.
+	auto wastedSpace = allocatedDataSize - requestedDataSize;
+	auto dataOffset = wastedSpace / alignment * alignment;
+	auto data = (char*)memory + dataOffset;
+	std::memset(data + requestedDataSize, CANARY, wastedSpace - dataOffset);
+
+	// without numa support this is the same as inherit, which is what single node machines do anyway
+	if(options.placement != mgrech::numa_policy::inherit)
+		os_place(memory, allocatedDataSize, options.placement, options.placement_nodes, false);
+
+	if(options.demote_behind_pages)
+		os_register_demotion(memory, options.demote_behind_pages);
+
+	// a snapshot shares its pages with the backing file, which fork policies cannot apply to
+	if(!options.snapshots)
+	{
+		auto canaryOffset = dataOffset + requestedDataSize;
+		os_register_fork(memory, allocatedDataSize, allocatedGuardSize, canaryOffset, options.on_fork);
+	}
+
+	// a snapshot replaces the mapping of the storage, which would lose the tracking state
+	if(!options.snapshots)
+		os_track_dirty(memory, allocatedDataSize, options.track_dirty_pages);
+
+	return data;
+}
+
+void mgrech::detail::guarded_dealloc(void* memory, size_type requestedDataSize, size_type requestedGuardSize)
+{
+	auto allocatedDataSize = ceil_multiple(requestedDataSize, PAGE_SIZE);
+	auto allocatedGuardSize = ceil_multiple(requestedGuardSize, PAGE_SIZE);
+	auto allocatedMemory = (char*)memory - data_offset(memory);
+	check_canary((char const*)memory + requestedDataSize, allocatedMemory + allocatedDataSize);
+	os_untrack_dirty(allocatedMemory);
+	os_unregister_demotion(allocatedMemory);
+	os_unregister_fork(allocatedMemory);
+	os_snapshot_release(allocatedMemory);
+	os_dealloc(allocatedMemory, allocatedDataSize + allocatedGuardSize);
+}
+
+void const* mgrech::detail::guarded_snapshot(void* memory, size_type requestedDataSize, size_type usedSize)
+{
+	auto allocatedDataSize = ceil_multiple(requestedDataSize, PAGE_SIZE);
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+	auto canaryOffset = dataOffset + requestedDataSize;
+	auto length = snapshot_length(dataOffset, usedSize);
+	auto snapshot = os_snapshot(allocatedMemory, allocatedDataSize, canaryOffset, length);
+	return snapshot ? (char const*)snapshot + dataOffset : nullptr;
+}
+
+void mgrech::detail::snapshot_dealloc(void const* snapshot, size_type requestedDataSize, size_type usedSize)
+{
+	(void)requestedDataSize;
+
+	auto dataOffset = data_offset(snapshot);
+	auto allocatedSnapshot = (char*)snapshot - dataOffset;
+	os_snapshot_dealloc(allocatedSnapshot, snapshot_length(dataOffset, usedSize));
+}
+
+void mgrech::detail::guarded_discard(void* memory, size_type requestedDataSize, size_type usedSize)
+{
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+
+	// leave the page holding the canary alone
+	auto dataEnd = dataOffset + requestedDataSize;
+	auto usedEnd = ceil_multiple(dataOffset + usedSize, PAGE_SIZE);
+	auto end = dataEnd % PAGE_SIZE == 0 || usedEnd <= dataEnd / PAGE_SIZE * PAGE_SIZE ? usedEnd
+	                                                                                  : dataEnd / PAGE_SIZE * PAGE_SIZE;
+
+	if(end != 0)
+		os_discard(allocatedMemory, end);
+}
+
+void mgrech::detail::guarded_zero(void* memory, size_type first, size_type last)
+{
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+	auto begin = ceil_multiple(dataOffset + first, PAGE_SIZE);
+	auto end = (dataOffset + last) / PAGE_SIZE * PAGE_SIZE;
+
+	if(begin >= end)
+	{
+		std::memset((char*)memory + first, 0, last - first);
+		return;
+	}
+
+	std::memset((char*)memory + first, 0, begin - dataOffset - first);
+	os_discard(allocatedMemory + begin, end - begin);
+	std::memset(allocatedMemory + end, 0, dataOffset + last - end);
+}
+
+void mgrech::detail::guarded_release_front(void* memory, size_type first, size_type last)
+{
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+
+	// the pages before the one holding first were released by earlier calls
+	auto begin = (dataOffset + first) / PAGE_SIZE * PAGE_SIZE;
+	auto end = (dataOffset + last) / PAGE_SIZE * PAGE_SIZE;
+
+	if(begin != end)
+		os_discard(allocatedMemory + begin, end - begin);
+}
+
+bool mgrech::detail::guarded_place(void* memory, size_type first, size_type last, mgrech::numa_policy policy,
+                                   std::uint64_t nodes)
+{
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+	auto begin = (dataOffset + first) / PAGE_SIZE * PAGE_SIZE;
+	auto end = ceil_multiple(dataOffset + last, PAGE_SIZE);
+	return os_place(allocatedMemory + begin, end - begin, policy, nodes, true);
+}
+
+bool mgrech::detail::guarded_advise(void* memory, size_type requestedDataSize, size_type first, size_type last,
+                                    page_advice advice)
+{
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+	auto inward = advice == page_advice::cold || advice == page_advice::pageout;
+	first += dataOffset;
+	last += dataOffset;
+
+	// the data part of the allocation ends at the guard page or in the page holding the canary
+	if(inward && last == dataOffset + requestedDataSize)
+		last = ceil_multiple(last, PAGE_SIZE);
+
+	auto begin = inward ? ceil_multiple(first, PAGE_SIZE) : first / PAGE_SIZE * PAGE_SIZE;
+	auto end = inward ? last / PAGE_SIZE * PAGE_SIZE : ceil_multiple(last, PAGE_SIZE);
+
+	if(begin >= end)
+		return false;
+
+	return os_advise(allocatedMemory + begin, end - begin, advice);
+}
+
+bool mgrech::detail::guarded_demote(void* memory, size_type usedSize)
+{
+	auto dataOffset = data_offset(memory);
+	return os_demote((char*)memory - dataOffset, dataOffset + usedSize);
+}
+
+void mgrech::detail::guarded_collect_dirty(void* memory, size_type requestedDataSize, size_type usedSize,
+                                           dirty_range_callback callback, void* context)
+{
+	(void)requestedDataSize;
+
+	auto dataOffset = data_offset(memory);
+	auto allocatedMemory = (char*)memory - dataOffset;
+	dirty_reporter report = {callback, context, dataOffset, dataOffset + usedSize, 0, 0};
+
+	if(!os_collect_dirty(allocatedMemory, dataOffset + usedSize, report))
+		report.add(0, dataOffset + usedSize);
+
+	report.flush();
+}
+
+bool mgrech::detail::stream_wait(stream_sync& sync, size_type n, std::int64_t timeoutNs) noexcept
+{
+	using clock = std::chrono::steady_clock;
+
+	// about 30 years, beyond that the deadline could overflow
+	if(timeoutNs > ((std::int64_t)1 << 60))
+		timeoutNs = -1;
+
+	auto deadline = clock::now() + std::chrono::nanoseconds(timeoutNs < 0 ? 0 : timeoutNs);
+
+	for(;;)
+	{
+		// announced before checking the size, so the producer either sees the bit or this sees the new size. a
+		// wakeup in between changes the word and makes the wait return right away.
+		auto expected = sync.futex.fetch_or(1) | 1;
+
+		if(sync.size.load() >= n || sync.closed.load())
+			break;
+
+		std::int64_t remaining = -1;
+
+		if(timeoutNs >= 0)
+		{
+			remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - clock::now()).count();
+
+			if(remaining <= 0)
+				break;
+		}
+
+		os_wait_on(sync, expected, remaining);
+	}
+
+	return sync.size.load(std::memory_order_acquire) >= n;
+}
+
+void mgrech::detail::stream_wake(stream_sync& sync) noexcept
+{
+	// only the producer clears the bit, so adding 1 clears it if it is set and counts up the rest
+	if(sync.futex.load() & 1)
+	{
+		sync.futex.fetch_add(1);
+		os_wake_all(sync);
+	}
+
+	auto& bucket = parking_bucket_for(sync);
+	stream_waiter* ready = nullptr;
+	auto readyEnd = &ready;
+
+	{
+		std::lock_guard<std::mutex> lock(bucket.mutex);
+		auto size = sync.size.load();
+		auto closed = sync.closed.load();
+		auto waiting = false;
+
+		for(auto it = &bucket.waiters; *it;)
+		{
+			auto waiter = *it;
+
+			if(waiter->sync != &sync)
+				it = &waiter->next;
+			else if(waiter->target <= size || closed)
+			{
+				*it = waiter->next;
+				waiter->next = nullptr;
+				*readyEnd = waiter;
+				readyEnd = &waiter->next;
+			}
+			else
+			{
+				waiting = true;
+				it = &waiter->next;
+			}
+		}
+
+		// the coroutines that keep waiting need the next append to come here again
+		if(waiting)
+			sync.futex.fetch_or(1);
+	}
+
+	// outside the lock, a resumed coroutine may wait again right away
+	while(ready)
+	{
+		auto waiter = ready;
+		ready = waiter->next;
+		waiter->resume(waiter);
+	}
+}
+
+bool mgrech::detail::stream_park(stream_waiter* waiter) noexcept
+{
+	auto& sync = *waiter->sync;
+	auto& bucket = parking_bucket_for(sync);
+
+	std::lock_guard<std::mutex> lock(bucket.mutex);
+	sync.futex.fetch_or(1);
+
+	if(sync.size.load() >= waiter->target || sync.closed.load())
+		return false;
+
+	waiter->next = bucket.waiters;
+	bucket.waiters = waiter;
+	return true;
+}
+
+// vectorized kernels
+
+// msvc allows the use of any intrinsic in any function, gcc and clang require the instruction set to be enabled
+#if defined(__clang__)
+#define OV_TARGET_BEGIN(isa) _Pragma(OV_STRINGIFY(clang attribute push(__attribute__((target(isa))), apply_to = function)))
+#define OV_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define OV_TARGET_BEGIN(isa) _Pragma("GCC push_options") _Pragma(OV_STRINGIFY(GCC target(isa)))
+#define OV_TARGET_END _Pragma("GCC pop_options")
+#else
+#define OV_TARGET_BEGIN(isa)
+#define OV_TARGET_END
+#endif
+
+namespace
+{
+
+using mgrech::compare_op;
+
+namespace scalar
+{
+
+template <typename E>
+size_type find(void const* data, size_type size, void const* value)
+{
+	auto p = (E const*)data;
+	auto v = *(E const*)value;
+
+	for(size_type i = 0; i != size; ++i)
+		if(p[i] == v)
+			return i;
+
+	return size;
+}
+
+template <typename E>
+size_type count(void const* data, size_type size, void const* value)
+{
+	auto p = (E const*)data;
+	auto v = *(E const*)value;
+	size_type n = 0;
+
+	for(size_type i = 0; i != size; ++i)
+		n += p[i] == v;
+
+	return n;
+}
+
+template <typename E>
+void sum(void const* data, size_type size, void* result)
+{
+	auto p = (E const*)data;
+	typename sum_type<E>::type s = 0;
+
+	for(size_type i = 0; i != size; ++i)
+		s += p[i];
+
+	*(typename sum_type<E>::type*)result = s;
+}
+
+template <typename E>
+void minimum(void const* data, size_type size, void* result)
+{
+	auto p = (E const*)data;
+	E m = p[0];
+
+	for(size_type i = 1; i != size; ++i)
+		if(p[i] < m)
+			m = p[i];
+
+	*(E*)result = m;
+}
+
+template <typename E>
+void maximum(void const* data, size_type size, void* result)
+{
+	auto p = (E const*)data;
+	E m = p[0];
+
+	for(size_type i = 1; i != size; ++i)
+		if(m < p[i])
+			m = p[i];
+
+	*(E*)result = m;
+}
+
+template <typename E>
+size_type compact(void* dst, size_type capacity, void const* src, size_type size, compare_op op, void const* value)
+{
+	(void)capacity;
+
+	auto d = (E*)dst;
+	auto p = (E const*)src;
+	auto v = *(E const*)value;
+	size_type n = 0;
+
+	for(size_type i = 0; i != size; ++i)
+		if(compare(p[i], op, v))
+			d[n++] = p[i];
+
+	return n;
+}
+
+template <typename E>
+kernel_table make_kernel_table()
+{
+	return {&find<E>, &count<E>, &sum<E>, &minimum<E>, &maximum<E>, &compact<E>};
+}
+
+size_type popcount(std::uint64_t const* words, size_type n)
+{
+	size_type count = 0;
+
+	for(size_type i = 0; i != n; ++i)
+		count += mgrech::detail::popcount64(words[i]);
+
+	return count;
+}
+
+} // namespace scalar
+
+#ifdef OVECTOR_X86
+
+// popcount of a lane mask, which has at most 8 bits
+inline OVECTOR_FORCE_INLINE
+unsigned popcount8(unsigned x)
+{
+	x = x - ((x >> 1) & 0x55);
+	x = (x & 0x33) + ((x >> 2) & 0x33);
+	return (x + (x >> 4)) & 0x0f;
+}
+
+// @pre x != 0
+inline OVECTOR_FORCE_INLINE
+unsigned count_trailing_zeros(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (unsigned)index;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+// compress_lut32[mask] holds the indices of the 32-bit lanes selected by mask, moved to the front
+std::uint32_t compress_lut32[256][8];
+
+// compress_lut8[mask] holds the byte shuffle moving the 32-bit lanes selected by mask to the front
+std::uint8_t compress_lut8[16][16];
+
+// duplicates every bit of a 4-bit mask, turning a mask of 64-bit lanes into a mask of 32-bit lanes
+std::uint8_t const widen_mask[16] =
+{
+	0x00, 0x03, 0x0c, 0x0f, 0x30, 0x33, 0x3c, 0x3f,
+	0xc0, 0xc3, 0xcc, 0xcf, 0xf0, 0xf3, 0xfc, 0xff,
+};
+
+void init_compress_luts()
+{
+	for(unsigned mask = 0; mask != 256; ++mask)
+	{
+		unsigned n = 0;
+
+		for(unsigned lane = 0; lane != 8; ++lane)
+			if(mask & (1u << lane))
+				compress_lut32[mask][n++] = lane;
+
+		for(; n != 8; ++n)
+			compress_lut32[mask][n] = 0;
+	}
+
+	for(unsigned mask = 0; mask != 16; ++mask)
+	{
+		unsigned n = 0;
+
+		for(unsigned lane = 0; lane != 4; ++lane)
+			if(mask & (1u << lane))
+				for(unsigned byte = 0; byte != 4; ++byte)
+					compress_lut8[mask][n++] = (std::uint8_t)(lane * 4 + byte);
+
+		for(; n != 16; ++n)
+			compress_lut8[mask][n] = 0x80;
+	}
+}
+
+struct cpu_features
+{
+	bool sse42;
+	bool avx2;
+};
+
+void cpuid(unsigned leaf, unsigned subleaf, unsigned (&regs)[4])
+{
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+
+	for(int i = 0; i != 4; ++i)
+		regs[i] = (unsigned)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+std::uint64_t xgetbv0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((std::uint64_t)edx << 32) | eax;
+#endif
+}
+
+cpu_features detect_cpu_features()
+{
+	cpu_features features = {false, false};
+	unsigned regs[4];
+
+	cpuid(0, 0, regs);
+	auto maxLeaf = regs[0];
+
+	if(maxLeaf < 1)
+		return features;
+
+	cpuid(1, 0, regs);
+	auto ecx1 = regs[2];
+	bool ssse3 = ecx1 & (1u << 9);
+	bool sse41 = ecx1 & (1u << 19);
+	bool sse42 = ecx1 & (1u << 20);
+	bool popcnt = ecx1 & (1u << 23);
+	bool osxsave = ecx1 & (1u << 27);
+	bool avx = ecx1 & (1u << 28);
+
+	features.sse42 = ssse3 && sse41 && sse42 && popcnt;
+
+	// the os must save the ymm registers on context switches
+	if(maxLeaf < 7 || !osxsave || !avx || (xgetbv0() & 0x6) != 0x6)
+		return features;
+
+	cpuid(7, 0, regs);
+	features.avx2 = features.sse42 && (regs[1] & (1u << 5));
+	return features;
+}
+
+OV_TARGET_BEGIN("sse4.2,popcnt")
+namespace sse42
+{
+
+inline OVECTOR_FORCE_INLINE
+void store_compressed32(void* dst, __m128i v, unsigned mask)
+{
+	auto shuffle = _mm_loadu_si128((__m128i const*)compress_lut8[mask]);
+	_mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(v, shuffle));
+}
+
+#include "ovector_simd.inl"
+
+inline OVECTOR_FORCE_INLINE
+size_type popcount64(std::uint64_t x)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return (size_type)_mm_popcnt_u64(x);
+#else
+	return (size_type)(_mm_popcnt_u32((unsigned)x) + _mm_popcnt_u32((unsigned)(x >> 32)));
+#endif
+}
+
+size_type popcount(std::uint64_t const* words, size_type n)
+{
+	// independent counters, popcnt has a latency of three cycles
+	size_type c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+	size_type i = 0;
+
+	for(; n - i >= 4; i += 4)
+	{
+		c0 += popcount64(words[i]);
+		c1 += popcount64(words[i + 1]);
+		c2 += popcount64(words[i + 2]);
+		c3 += popcount64(words[i + 3]);
+	}
+
+	for(; i != n; ++i)
+		c0 += popcount64(words[i]);
+
+	return (c0 + c1) + (c2 + c3);
+}
+
+struct int_ops
+{
+	using vec = __m128i;
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_zero()
+	{
+		return _mm_setzero_si128();
+	}
+};
+
+struct int32_ops : int_ops
+{
+	static constexpr size_type lanes = 4;
+	static constexpr unsigned all = 0xf;
+
+	OVECTOR_FORCE_INLINE
+	static vec load(void const* p)
+	{
+		return _mm_loadu_si128((__m128i const*)p);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store(void* p, vec v)
+	{
+		_mm_storeu_si128((__m128i*)p, v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec eq(vec a, vec b)
+	{
+		return _mm_cmpeq_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned movemask(vec a)
+	{
+		return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask_eq(vec a, vec b)
+	{
+		return movemask(eq(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(void* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, v, mask);
+	}
+};
+
+struct int64_ops : int_ops
+{
+	static constexpr size_type lanes = 2;
+	static constexpr unsigned all = 0x3;
+
+	OVECTOR_FORCE_INLINE
+	static vec load(void const* p)
+	{
+		return _mm_loadu_si128((__m128i const*)p);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store(void* p, vec v)
+	{
+		_mm_storeu_si128((__m128i*)p, v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec eq(vec a, vec b)
+	{
+		return _mm_cmpeq_epi64(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned movemask(vec a)
+	{
+		return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask_eq(vec a, vec b)
+	{
+		return movemask(eq(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		return _mm_add_epi64(acc, v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(void* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, v, widen_mask[mask]);
+	}
+};
+
+template <>
+struct ops<std::int32_t> : int32_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::int32_t v)
+	{
+		return _mm_set1_epi32(v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		return _mm_cmpgt_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm_min_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm_max_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+		return _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static long long acc_reduce(vec acc)
+	{
+		std::int64_t lanes[2];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		return lanes[0] + lanes[1];
+	}
+};
+
+template <>
+struct ops<std::uint32_t> : int32_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::uint32_t v)
+	{
+		return _mm_set1_epi32((int)v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		// there is no unsigned comparison, flip the sign bits and compare as signed
+		auto sign = _mm_set1_epi32(INT32_MIN);
+		return _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm_min_epu32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm_max_epu32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(v));
+		return _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(v, 8)));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[2];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		return lanes[0] + lanes[1];
+	}
+};
+
+template <>
+struct ops<std::int64_t> : int64_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::int64_t v)
+	{
+		return _mm_set1_epi64x(v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		return _mm_cmpgt_epi64(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm_blendv_epi8(a, b, gt(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm_blendv_epi8(a, b, gt(b, a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[2];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		return (long long)(lanes[0] + lanes[1]);
+	}
+};
+
+template <>
+struct ops<std::uint64_t> : int64_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::uint64_t v)
+	{
+		return _mm_set1_epi64x((long long)v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		auto sign = _mm_set1_epi64x(INT64_MIN);
+		return _mm_cmpgt_epi64(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm_blendv_epi8(a, b, gt(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm_blendv_epi8(a, b, gt(b, a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[2];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		return lanes[0] + lanes[1];
+	}
+};
+
+template <>
+struct ops<float>
+{
+	using vec = __m128;
+	static constexpr size_type lanes = 4;
+
+	OVECTOR_FORCE_INLINE static vec set1(float v)               { return _mm_set1_ps(v); }
+	OVECTOR_FORCE_INLINE static vec load(float const* p)        { return _mm_loadu_ps(p); }
+	OVECTOR_FORCE_INLINE static void store(float* p, vec v)     { _mm_storeu_ps(p, v); }
+	OVECTOR_FORCE_INLINE static vec vmin(vec a, vec b)          { return _mm_min_ps(a, b); }
+	OVECTOR_FORCE_INLINE static vec vmax(vec a, vec b)          { return _mm_max_ps(a, b); }
+	OVECTOR_FORCE_INLINE static vec acc_zero()                  { return _mm_setzero_ps(); }
+	OVECTOR_FORCE_INLINE static vec acc_add(vec acc, vec v)     { return _mm_add_ps(acc, v); }
+	OVECTOR_FORCE_INLINE static unsigned mask_eq(vec a, vec b)  { return (unsigned)_mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		switch(op)
+		{
+		case compare_op::equal:         return (unsigned)_mm_movemask_ps(_mm_cmpeq_ps(a, b));
+		case compare_op::not_equal:     return (unsigned)_mm_movemask_ps(_mm_cmpneq_ps(a, b));
+		case compare_op::less:          return (unsigned)_mm_movemask_ps(_mm_cmplt_ps(a, b));
+		case compare_op::less_equal:    return (unsigned)_mm_movemask_ps(_mm_cmple_ps(a, b));
+		case compare_op::greater:       return (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(a, b));
+		case compare_op::greater_equal: return (unsigned)_mm_movemask_ps(_mm_cmpge_ps(a, b));
+		}
+
+		return 0;
+	}
+
+	OVECTOR_FORCE_INLINE
+	static float acc_reduce(vec acc)
+	{
+		float lanes[4];
+		_mm_storeu_ps(lanes, acc);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(float* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, _mm_castps_si128(v), mask);
+	}
+};
+
+template <>
+struct ops<double>
+{
+	using vec = __m128d;
+	static constexpr size_type lanes = 2;
+
+	OVECTOR_FORCE_INLINE static vec set1(double v)              { return _mm_set1_pd(v); }
+	OVECTOR_FORCE_INLINE static vec load(double const* p)       { return _mm_loadu_pd(p); }
+	OVECTOR_FORCE_INLINE static void store(double* p, vec v)    { _mm_storeu_pd(p, v); }
+	OVECTOR_FORCE_INLINE static vec vmin(vec a, vec b)          { return _mm_min_pd(a, b); }
+	OVECTOR_FORCE_INLINE static vec vmax(vec a, vec b)          { return _mm_max_pd(a, b); }
+	OVECTOR_FORCE_INLINE static vec acc_zero()                  { return _mm_setzero_pd(); }
+	OVECTOR_FORCE_INLINE static vec acc_add(vec acc, vec v)     { return _mm_add_pd(acc, v); }
+	OVECTOR_FORCE_INLINE static unsigned mask_eq(vec a, vec b)  { return (unsigned)_mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		switch(op)
+		{
+		case compare_op::equal:         return (unsigned)_mm_movemask_pd(_mm_cmpeq_pd(a, b));
+		case compare_op::not_equal:     return (unsigned)_mm_movemask_pd(_mm_cmpneq_pd(a, b));
+		case compare_op::less:          return (unsigned)_mm_movemask_pd(_mm_cmplt_pd(a, b));
+		case compare_op::less_equal:    return (unsigned)_mm_movemask_pd(_mm_cmple_pd(a, b));
+		case compare_op::greater:       return (unsigned)_mm_movemask_pd(_mm_cmpgt_pd(a, b));
+		case compare_op::greater_equal: return (unsigned)_mm_movemask_pd(_mm_cmpge_pd(a, b));
+		}
+
+		return 0;
+	}
+
+	OVECTOR_FORCE_INLINE
+	static double acc_reduce(vec acc)
+	{
+		double lanes[2];
+		_mm_storeu_pd(lanes, acc);
+		return lanes[0] + lanes[1];
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(double* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, _mm_castpd_si128(v), widen_mask[mask]);
+	}
+};
+
+} // namespace sse42
+OV_TARGET_END
+
+OV_TARGET_BEGIN("avx2,popcnt")
+namespace avx2
+{
+
+inline OVECTOR_FORCE_INLINE
+void store_compressed32(void* dst, __m256i v, unsigned mask)
+{
+	auto indices = _mm256_loadu_si256((__m256i const*)compress_lut32[mask]);
+	_mm256_storeu_si256((__m256i*)dst, _mm256_permutevar8x32_epi32(v, indices));
+}
+
+#include "ovector_simd.inl"
+
+// counts the bits of every nibble with a shuffle and sums the bytes with psadbw, see Mula, Kurz and Lemire,
+// "Faster Population Counts Using AVX2 Instructions"
+size_type popcount(std::uint64_t const* words, size_type n)
+{
+	// popcnt is as fast for a few words, e.g. within a block of the rank index
+	if(n < 8)
+		return sse42::popcount(words, n);
+
+	auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+	                               0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	auto nibble = _mm256_set1_epi8(0x0f);
+	auto total = _mm256_setzero_si256();
+	size_type i = 0;
+
+	// a byte counter holds at most 8 per vector, so sum them up every 31 vectors at the latest
+	while(n - i >= 4)
+	{
+		auto bytes = _mm256_setzero_si256();
+		auto end = n - i >= 4 * 31 ? i + 4 * 31 : i + (n - i) / 4 * 4;
+
+		for(; i != end; i += 4)
+		{
+			auto v = _mm256_loadu_si256((__m256i const*)(words + i));
+			auto lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+			auto hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+			bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(lo, hi));
+		}
+
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+	}
+
+	std::uint64_t lanes[4];
+	_mm256_storeu_si256((__m256i*)lanes, total);
+	auto count = (size_type)((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+	return count + sse42::popcount(words + i, n - i);
+}
+
+struct int_ops
+{
+	using vec = __m256i;
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_zero()
+	{
+		return _mm256_setzero_si256();
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec load(void const* p)
+	{
+		return _mm256_loadu_si256((__m256i const*)p);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store(void* p, vec v)
+	{
+		_mm256_storeu_si256((__m256i*)p, v);
+	}
+};
+
+struct int32_ops : int_ops
+{
+	static constexpr size_type lanes = 8;
+	static constexpr unsigned all = 0xff;
+
+	OVECTOR_FORCE_INLINE
+	static vec eq(vec a, vec b)
+	{
+		return _mm256_cmpeq_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned movemask(vec a)
+	{
+		return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask_eq(vec a, vec b)
+	{
+		return movemask(eq(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(void* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, v, mask);
+	}
+};
+
+struct int64_ops : int_ops
+{
+	static constexpr size_type lanes = 4;
+	static constexpr unsigned all = 0xf;
+
+	OVECTOR_FORCE_INLINE
+	static vec eq(vec a, vec b)
+	{
+		return _mm256_cmpeq_epi64(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned movemask(vec a)
+	{
+		return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask_eq(vec a, vec b)
+	{
+		return movemask(eq(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		return _mm256_add_epi64(acc, v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(void* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, v, widen_mask[mask]);
+	}
+};
+
+template <>
+struct ops<std::int32_t> : int32_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::int32_t v)
+	{
+		return _mm256_set1_epi32(v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		return _mm256_cmpgt_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm256_min_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm256_max_epi32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+		return _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static long long acc_reduce(vec acc)
+	{
+		std::int64_t lanes[4];
+		store(lanes, acc);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+};
+
+template <>
+struct ops<std::uint32_t> : int32_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::uint32_t v)
+	{
+		return _mm256_set1_epi32((int)v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		// there is no unsigned comparison, flip the sign bits and compare as signed
+		auto sign = _mm256_set1_epi32(INT32_MIN);
+		return _mm256_cmpgt_epi32(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm256_min_epu32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm256_max_epu32(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec acc_add(vec acc, vec v)
+	{
+		acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+		return _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[4];
+		store(lanes, acc);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+};
+
+template <>
+struct ops<std::int64_t> : int64_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::int64_t v)
+	{
+		return _mm256_set1_epi64x(v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		return _mm256_cmpgt_epi64(a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm256_blendv_epi8(a, b, gt(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm256_blendv_epi8(a, b, gt(b, a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[4];
+		store(lanes, acc);
+		return (long long)((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+	}
+};
+
+template <>
+struct ops<std::uint64_t> : int64_ops
+{
+	OVECTOR_FORCE_INLINE
+	static vec set1(std::uint64_t v)
+	{
+		return _mm256_set1_epi64x((long long)v);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec gt(vec a, vec b)
+	{
+		auto sign = _mm256_set1_epi64x(INT64_MIN);
+		return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		return int_compare_mask<ops>(op, a, b);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmin(vec a, vec b)
+	{
+		return _mm256_blendv_epi8(a, b, gt(a, b));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static vec vmax(vec a, vec b)
+	{
+		return _mm256_blendv_epi8(a, b, gt(b, a));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static unsigned long long acc_reduce(vec acc)
+	{
+		std::uint64_t lanes[4];
+		store(lanes, acc);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+};
+
+template <>
+struct ops<float>
+{
+	using vec = __m256;
+	static constexpr size_type lanes = 8;
+
+	OVECTOR_FORCE_INLINE static vec set1(float v)               { return _mm256_set1_ps(v); }
+	OVECTOR_FORCE_INLINE static vec load(float const* p)        { return _mm256_loadu_ps(p); }
+	OVECTOR_FORCE_INLINE static void store(float* p, vec v)     { _mm256_storeu_ps(p, v); }
+	OVECTOR_FORCE_INLINE static vec vmin(vec a, vec b)          { return _mm256_min_ps(a, b); }
+	OVECTOR_FORCE_INLINE static vec vmax(vec a, vec b)          { return _mm256_max_ps(a, b); }
+	OVECTOR_FORCE_INLINE static vec acc_zero()                  { return _mm256_setzero_ps(); }
+	OVECTOR_FORCE_INLINE static vec acc_add(vec acc, vec v)     { return _mm256_add_ps(acc, v); }
+	OVECTOR_FORCE_INLINE static unsigned mask_eq(vec a, vec b)  { return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		switch(op)
+		{
+		case compare_op::equal:         return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+		case compare_op::not_equal:     return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_NEQ_UQ));
+		case compare_op::less:          return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+		case compare_op::less_equal:    return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ));
+		case compare_op::greater:       return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ));
+		case compare_op::greater_equal: return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ));
+		}
+
+		return 0;
+	}
+
+	OVECTOR_FORCE_INLINE
+	static float acc_reduce(vec acc)
+	{
+		float lanes[8];
+		_mm256_storeu_ps(lanes, acc);
+		return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(float* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, _mm256_castps_si256(v), mask);
+	}
+};
+
+template <>
+struct ops<double>
+{
+	using vec = __m256d;
+	static constexpr size_type lanes = 4;
+
+	OVECTOR_FORCE_INLINE static vec set1(double v)              { return _mm256_set1_pd(v); }
+	OVECTOR_FORCE_INLINE static vec load(double const* p)       { return _mm256_loadu_pd(p); }
+	OVECTOR_FORCE_INLINE static void store(double* p, vec v)    { _mm256_storeu_pd(p, v); }
+	OVECTOR_FORCE_INLINE static vec vmin(vec a, vec b)          { return _mm256_min_pd(a, b); }
+	OVECTOR_FORCE_INLINE static vec vmax(vec a, vec b)          { return _mm256_max_pd(a, b); }
+	OVECTOR_FORCE_INLINE static vec acc_zero()                  { return _mm256_setzero_pd(); }
+	OVECTOR_FORCE_INLINE static vec acc_add(vec acc, vec v)     { return _mm256_add_pd(acc, v); }
+	OVECTOR_FORCE_INLINE static unsigned mask_eq(vec a, vec b)  { return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+
+	OVECTOR_FORCE_INLINE
+	static unsigned mask(compare_op op, vec a, vec b)
+	{
+		switch(op)
+		{
+		case compare_op::equal:         return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));
+		case compare_op::not_equal:     return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ));
+		case compare_op::less:          return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ));
+		case compare_op::less_equal:    return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ));
+		case compare_op::greater:       return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+		case compare_op::greater_equal: return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GE_OQ));
+		}
+
+		return 0;
+	}
+
+	OVECTOR_FORCE_INLINE
+	static double acc_reduce(vec acc)
+	{
+		double lanes[4];
+		_mm256_storeu_pd(lanes, acc);
+		return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	}
+
+	OVECTOR_FORCE_INLINE
+	static void store_compressed(double* dst, vec v, unsigned mask)
+	{
+		store_compressed32(dst, _mm256_castpd_si256(v), widen_mask[mask]);
+	}
+};
+
+} // namespace avx2
+OV_TARGET_END
+
+#endif
+
+#ifdef OVECTOR_X86
+
+// one table per element type, in the order of kernel_type
+struct x86_kernel_tables
+{
+	kernel_table sse42[6];
+	kernel_table avx2[6];
+};
+
+x86_kernel_tables make_x86_kernel_tables()
+{
+	init_compress_luts();
+
+	return
+	{
+		{
+			sse42::make_kernel_table<std::int32_t>(),
+			sse42::make_kernel_table<std::uint32_t>(),
+			sse42::make_kernel_table<std::int64_t>(),
+			sse42::make_kernel_table<std::uint64_t>(),
+			sse42::make_kernel_table<float>(),
+			sse42::make_kernel_table<double>(),
+		},
+		{
+			avx2::make_kernel_table<std::int32_t>(),
+			avx2::make_kernel_table<std::uint32_t>(),
+			avx2::make_kernel_table<std::int64_t>(),
+			avx2::make_kernel_table<std::uint64_t>(),
+			avx2::make_kernel_table<float>(),
+			avx2::make_kernel_table<double>(),
+		},
+	};
+}
+
+#endif
+
+} // namespace
+
+mgrech::detail::kernel_isa mgrech::detail::detect_kernel_isa() noexcept
+{
+#ifdef OVECTOR_X86
+	auto features = detect_cpu_features();
+
+	if(features.avx2)
+		return kernel_isa::avx2;
+
+	if(features.sse42)
+		return kernel_isa::sse42;
+#endif
+
+	return kernel_isa::scalar;
+}
+
+mgrech::detail::popcount_kernel mgrech::detail::popcount_kernel_for(kernel_isa isa) noexcept
+{
+#ifdef OVECTOR_X86
+	switch(isa)
+	{
+	case kernel_isa::avx2:  return &avx2::popcount;
+	case kernel_isa::sse42: return &sse42::popcount;
+	case kernel_isa::scalar: break;
+	}
+#else
+	(void)isa;
+#endif
+
+	return &scalar::popcount;
+}
+
+mgrech::detail::kernel_table const& mgrech::detail::kernels(kernel_type type, kernel_isa isa) noexcept
+{
+	static kernel_table const scalarTables[] =
+	{
+		scalar::make_kernel_table<std::int32_t>(),
+		scalar::make_kernel_table<std::uint32_t>(),
+		scalar::make_kernel_table<std::int64_t>(),
+		scalar::make_kernel_table<std::uint64_t>(),
+		scalar::make_kernel_table<float>(),
+		scalar::make_kernel_table<double>(),
+	};
+
+	auto index = (int)type - 1;
+	assert(index >= 0 && index < 6);
+
+#ifdef OVECTOR_X86
+	static x86_kernel_tables const x86Tables = make_x86_kernel_tables();
+
+	switch(isa)
+	{
+	case kernel_isa::avx2:  return x86Tables.avx2[index];
+	case kernel_isa::sse42: return x86Tables.sse42[index];
+	case kernel_isa::scalar: break;
+	}
+#else
+	(void)isa;
+#endif
+
+	return scalarTables[index];
 }
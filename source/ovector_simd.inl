@@ -0,0 +1,225 @@
+// Copyright 2020-2021 Markus Grech
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// 	http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Vectorized kernels, included by ovector.cpp once per instruction set inside a namespace that provides the
+// vector operations for each element type via ops<E>. The kernels are written once and compiled for every
+// instruction set because functions can only be inlined into functions targeting the same instruction set.
+//
+// ops<E> provides:
+//   vec                                      vector type
+//   lanes                                    number of elements per vector
+//   all                                      mask with one bit set per lane
+//   set1(E), load(E const*), store(E*, vec)
+//   mask_eq(vec, vec)                        lanes that compare equal as a bit mask
+//   mask(compare_op, vec, vec)               lanes that satisfy the comparison as a bit mask
+//   vmin(vec, vec), vmax(vec, vec)           lane-wise minimum and maximum
+//   acc_zero(), acc_add(acc, vec), acc_reduce(acc)
+//                                            accumulator for sums, possibly wider than the elements
+//   store_compressed(E*, vec, mask)          store the selected lanes contiguously, writes a whole vector
+//
+// integer ops may implement mask via int_compare_mask, which requires eq(vec, vec), gt(vec, vec) and
+// movemask(vec).
+
+template <typename E>
+struct ops;
+
+// derives all comparisons of integer vectors from eq and gt
+template <typename O>
+inline OVECTOR_FORCE_INLINE
+unsigned int_compare_mask(compare_op op, typename O::vec a, typename O::vec b)
+{
+	switch(op)
+	{
+	case compare_op::equal:         return O::movemask(O::eq(a, b));
+	case compare_op::not_equal:     return O::movemask(O::eq(a, b)) ^ O::all;
+	case compare_op::less:          return O::movemask(O::gt(b, a));
+	case compare_op::less_equal:    return O::movemask(O::gt(a, b)) ^ O::all;
+	case compare_op::greater:       return O::movemask(O::gt(a, b));
+	case compare_op::greater_equal: return O::movemask(O::gt(b, a)) ^ O::all;
+	}
+
+	return 0;
+}
+
+template <typename E>
+size_type find(void const* data, size_type size, void const* value)
+{
+	using O = ops<E>;
+
+	auto p = (E const*)data;
+	auto v = *(E const*)value;
+	auto vv = O::set1(v);
+	size_type i = 0;
+
+	for(; size - i >= O::lanes; i += O::lanes)
+	{
+		auto mask = O::mask_eq(O::load(p + i), vv);
+
+		if(mask)
+			return i + count_trailing_zeros(mask);
+	}
+
+	for(; i != size; ++i)
+		if(p[i] == v)
+			return i;
+
+	return size;
+}
+
+template <typename E>
+size_type count(void const* data, size_type size, void const* value)
+{
+	using O = ops<E>;
+
+	auto p = (E const*)data;
+	auto v = *(E const*)value;
+	auto vv = O::set1(v);
+	size_type i = 0;
+	size_type n = 0;
+
+	for(; size - i >= O::lanes; i += O::lanes)
+		n += popcount8(O::mask_eq(O::load(p + i), vv));
+
+	for(; i != size; ++i)
+		n += p[i] == v;
+
+	return n;
+}
+
+template <typename E>
+void sum(void const* data, size_type size, void* result)
+{
+	using O = ops<E>;
+
+	auto p = (E const*)data;
+	auto acc0 = O::acc_zero();
+	auto acc1 = O::acc_zero();
+	size_type i = 0;
+
+	// two independent accumulators hide the latency of the additions
+	for(; size - i >= 2 * O::lanes; i += 2 * O::lanes)
+	{
+		acc0 = O::acc_add(acc0, O::load(p + i));
+		acc1 = O::acc_add(acc1, O::load(p + i + O::lanes));
+	}
+
+	if(size - i >= O::lanes)
+	{
+		acc0 = O::acc_add(acc0, O::load(p + i));
+		i += O::lanes;
+	}
+
+	auto s = O::acc_reduce(acc0) + O::acc_reduce(acc1);
+
+	for(; i != size; ++i)
+		s += p[i];
+
+	*(typename sum_type<E>::type*)result = s;
+}
+
+template <typename E>
+void minimum(void const* data, size_type size, void* result)
+{
+	using O = ops<E>;
+
+	auto p = (E const*)data;
+	size_type i = 0;
+	E m = p[0];
+
+	if(size >= O::lanes)
+	{
+		auto vm = O::load(p);
+
+		for(i = O::lanes; size - i >= O::lanes; i += O::lanes)
+			vm = O::vmin(vm, O::load(p + i));
+
+		E lanes[O::lanes];
+		O::store(lanes, vm);
+
+		for(size_type j = 0; j != O::lanes; ++j)
+			if(lanes[j] < m)
+				m = lanes[j];
+	}
+
+	for(; i != size; ++i)
+		if(p[i] < m)
+			m = p[i];
+
+	*(E*)result = m;
+}
+
+template <typename E>
+void maximum(void const* data, size_type size, void* result)
+{
+	using O = ops<E>;
+
+	auto p = (E const*)data;
+	size_type i = 0;
+	E m = p[0];
+
+	if(size >= O::lanes)
+	{
+		auto vm = O::load(p);
+
+		for(i = O::lanes; size - i >= O::lanes; i += O::lanes)
+			vm = O::vmax(vm, O::load(p + i));
+
+		E lanes[O::lanes];
+		O::store(lanes, vm);
+
+		for(size_type j = 0; j != O::lanes; ++j)
+			if(m < lanes[j])
+				m = lanes[j];
+	}
+
+	for(; i != size; ++i)
+		if(m < p[i])
+			m = p[i];
+
+	*(E*)result = m;
+}
+
+template <typename E>
+size_type compact(void* dst, size_type capacity, void const* src, size_type size, compare_op op, void const* value)
+{
+	using O = ops<E>;
+
+	auto d = (E*)dst;
+	auto p = (E const*)src;
+	auto v = *(E const*)value;
+	auto vv = O::set1(v);
+	size_type i = 0;
+	size_type n = 0;
+
+	// a compressed store writes a whole vector, so stop once there is less space left than that
+	for(; size - i >= O::lanes && capacity - n >= O::lanes; i += O::lanes)
+	{
+		auto x = O::load(p + i);
+		auto mask = O::mask(op, x, vv);
+		O::store_compressed(d + n, x, mask);
+		n += popcount8(mask);
+	}
+
+	for(; i != size; ++i)
+		if(compare(p[i], op, v))
+			d[n++] = p[i];
+
+	return n;
+}
+
+template <typename E>
+kernel_table make_kernel_table()
+{
+	return {&find<E>, &count<E>, &sum<E>, &minimum<E>, &maximum<E>, &compact<E>};
+}
@@ -1,7 +1,23 @@
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include <mgrech/ovector.hpp>
 
 using mgrech::ovector;
@@ -153,3 +169,1251 @@ TEST(ovector, guard_page_set_up_correctly)
 
 	ASSERT_DEATH(v.push_back('b'), "");
 }
+
+TEST(ovector, alignment)
+{
+	std::size_t const alignments[] = {0, 64, 4096, 2 * 1024 * 1024};
+	std::size_t const sizes[] = {1, 100, 1000, 5000};
+
+	for(auto alignment : alignments)
+	{
+		for(auto size : sizes)
+		{
+			mgrech::ovector_options options;
+			options.alignment = alignment;
+			auto v = ovector<int>::with_max_size_or_null(size, options);
+			ASSERT_NE(v.data(), nullptr);
+			ASSERT_EQ((std::uintptr_t)v.data() % (alignment ? alignment : alignof(int)), 0);
+
+			for(std::size_t i = 0; i != size; ++i)
+				v.push_back((int)i);
+
+			ASSERT_EQ(v.back(), (int)size - 1);
+		}
+	}
+
+	mgrech::ovector_options options;
+	options.alignment = 48;
+	ASSERT_EQ(ovector<int>::with_max_size_or_null(16, options).data(), nullptr);
+}
+
+TEST(ovector, alignment_canary)
+{
+	mgrech::ovector_options options;
+	options.alignment = 64;
+	auto v = ovector<char>::with_max_size_or_null(1, options);
+	v.push_back('a');
+
+	ASSERT_DEATH({ v.data()[1] = 'b'; v = ovector<char>(); }, "write past the end");
+}
+
+TEST(ovector, erase_range_relocatable)
+{
+	auto v = ovector<int>::with_max_size_or_null(8);
+
+	for(int i = 0; i != 6; ++i)
+		v.push_back(i);
+
+	auto p = v.erase(v.begin() + 1, v.begin() + 3);
+
+	ASSERT_EQ(p, v.begin() + 1);
+	ASSERT_EQ(v.size(), 4);
+	ASSERT_EQ(v[0], 0);
+	ASSERT_EQ(v[1], 3);
+	ASSERT_EQ(v[2], 4);
+	ASSERT_EQ(v[3], 5);
+}
+
+TEST(ovector, erase_range_nonrelocatable)
+{
+	auto v = ovector<std::string>::with_max_size_or_null(8);
+	v.emplace_back("a");
+	v.emplace_back("b");
+	v.emplace_back("c");
+	v.emplace_back("d");
+
+	v.erase(v.begin());
+	v.erase(v.begin() + 1, v.end());
+
+	ASSERT_EQ(v.size(), 1);
+	ASSERT_EQ(v[0], "b");
+}
+
+TEST(ovector, insert_range_relocatable)
+{
+	auto v = ovector<int>::with_max_size_or_null(8);
+	v.push_back(1);
+	v.push_back(4);
+
+	int values[] = {2, 3};
+	auto p = v.insert(v.begin() + 1, values, values + 2);
+
+	ASSERT_EQ(p, v.begin() + 1);
+	ASSERT_EQ(v.size(), 4);
+
+	for(int i = 0; i != 4; ++i)
+		ASSERT_EQ(v[i], i + 1);
+}
+
+TEST(ovector, insert_range_nonrelocatable)
+{
+	auto v = ovector<std::string>::with_max_size_or_null(8);
+	v.emplace_back("a");
+	v.emplace_back("d");
+
+	std::string values[] = {"b", "c"};
+	v.insert(v.begin() + 1, values, values + 2);
+	v.insert(v.end(), values, values + 1);
+
+	ASSERT_EQ(v.size(), 5);
+	ASSERT_EQ(v[0], "a");
+	ASSERT_EQ(v[1], "b");
+	ASSERT_EQ(v[2], "c");
+	ASSERT_EQ(v[3], "d");
+	ASSERT_EQ(v[4], "b");
+}
+
+TEST(ovector, swap_remove)
+{
+	auto v = ovector<int>::with_max_size_or_null(4);
+	v.push_back(1);
+	v.push_back(2);
+	v.push_back(3);
+
+	v.swap_remove(0);
+	ASSERT_EQ(v.size(), 2);
+	ASSERT_EQ(v[0], 3);
+	ASSERT_EQ(v[1], 2);
+
+	v.swap_remove(1);
+	ASSERT_EQ(v.size(), 1);
+	ASSERT_EQ(v[0], 3);
+}
+
+TEST(ovector, erase_if_relocatable)
+{
+	auto v = ovector<int>::with_max_size_or_null(16);
+
+	for(int i = 0; i != 10; ++i)
+		v.push_back(i);
+
+	auto removed = v.erase_if([](int i) { return i % 3 == 0; });
+
+	ASSERT_EQ(removed, 4);
+	ASSERT_EQ(v.size(), 6);
+
+	int expected[] = {1, 2, 4, 5, 7, 8};
+
+	for(int i = 0; i != 6; ++i)
+		ASSERT_EQ(v[i], expected[i]);
+}
+
+TEST(ovector, erase_if_nonrelocatable)
+{
+	auto v = ovector<dtor_counted>::with_max_size_or_null(4);
+	v.emplace_back();
+	v.emplace_back();
+	v.emplace_back();
+
+	int n = 0;
+	auto removed = v.erase_if([&](dtor_counted const&) { return n++ != 1; });
+
+	ASSERT_EQ(removed, 2);
+	ASSERT_EQ(v.size(), 1);
+}
+
+TEST(ovector, op_eq_bitwise)
+{
+	auto v1 = ovector<int>::with_max_size_or_null(100);
+	auto v2 = ovector<int>::with_max_size_or_null(100);
+
+	for(int i = 0; i != 100; ++i)
+	{
+		v1.push_back(i);
+		v2.push_back(i);
+	}
+
+	ASSERT_EQ(v1, v2);
+	v2[99] = 0;
+	ASSERT_NE(v1, v2);
+	ASSERT_EQ(ovector<int>(), ovector<int>());
+}
+
+template <typename T>
+static
+void check_kernels(mgrech::detail::kernel_isa isa)
+{
+	using namespace mgrech::detail;
+
+	auto& k = kernels(kernel_type_of<T>::value, isa);
+	T data[67];
+	T out[67];
+
+	// sizes cover empty input, partial vectors and several full vectors of every width
+	for(size_type size = 0; size != 67; ++size)
+	{
+		for(size_type i = 0; i != size; ++i)
+			data[i] = (T)((i * 7 + size) % 13) - (T)(std::is_signed<T>::value ? 6 : 0);
+
+		T value = data[size / 2];
+		size_type found = size, counted = 0;
+		typename sum_type<T>::type total = 0;
+
+		for(size_type i = 0; i != size; ++i)
+		{
+			if(data[i] == value && found == size)
+				found = i;
+
+			counted += data[i] == value;
+			total += data[i];
+		}
+
+		ASSERT_EQ(k.find(data, size, &value), found);
+		ASSERT_EQ(k.count(data, size, &value), counted);
+
+		typename sum_type<T>::type s;
+		k.sum(data, size, &s);
+		ASSERT_EQ(s, total);
+
+		if(size == 0)
+			continue;
+
+		T m;
+		k.minimum(data, size, &m);
+		ASSERT_EQ(m, *std::min_element(data, data + size));
+		k.maximum(data, size, &m);
+		ASSERT_EQ(m, *std::max_element(data, data + size));
+
+		mgrech::compare_op const ops[] =
+		{
+			mgrech::compare_op::equal,
+			mgrech::compare_op::not_equal,
+			mgrech::compare_op::less,
+			mgrech::compare_op::less_equal,
+			mgrech::compare_op::greater,
+			mgrech::compare_op::greater_equal,
+		};
+
+		for(auto op : ops)
+		{
+			auto n = k.compact(out, 67, data, size, op, &value);
+			size_type expected = 0;
+
+			for(size_type i = 0; i != size; ++i)
+			{
+				if(compare(data[i], op, value))
+				{
+					ASSERT_EQ(out[expected++], data[i]);
+				}
+			}
+
+			ASSERT_EQ(n, expected);
+		}
+	}
+}
+
+TEST(ovector, kernels)
+{
+	using mgrech::detail::kernel_isa;
+
+	auto best = mgrech::detail::detect_kernel_isa();
+	kernel_isa const isas[] = {kernel_isa::scalar, kernel_isa::sse42, kernel_isa::avx2};
+
+	for(auto isa : isas)
+	{
+		if(isa > best)
+			break;
+
+		check_kernels<std::int32_t>(isa);
+		check_kernels<std::uint32_t>(isa);
+		check_kernels<std::int64_t>(isa);
+		check_kernels<std::uint64_t>(isa);
+		check_kernels<float>(isa);
+		check_kernels<double>(isa);
+	}
+}
+
+TEST(ovector, find_count)
+{
+	auto v = ovector<int>::with_max_size_or_null(100);
+
+	for(int i = 0; i != 100; ++i)
+		v.push_back(i % 10);
+
+	ASSERT_EQ(mgrech::find(v, 7), v.begin() + 7);
+	ASSERT_EQ(mgrech::find(v, 10), v.end());
+	ASSERT_EQ(mgrech::count(v, 3), 10);
+
+	auto s = ovector<std::string>::with_max_size_or_null(2);
+	s.emplace_back("a");
+	s.emplace_back("b");
+
+	ASSERT_EQ(mgrech::find(s, std::string("b")), s.begin() + 1);
+	ASSERT_EQ(mgrech::count(s, std::string("c")), 0);
+}
+
+TEST(ovector, sum_min_max)
+{
+	auto v = ovector<std::int32_t>::with_max_size_or_null(100);
+
+	for(int i = 0; i != 100; ++i)
+		v.push_back(i == 50 ? 2000000000 : i - 10);
+
+	ASSERT_EQ(mgrech::sum(v), 2000000000ll + 3950 - 40);
+	ASSERT_EQ(mgrech::min_value(v), -10);
+	ASSERT_EQ(mgrech::max_value(v), 2000000000);
+}
+
+TEST(ovector, compact_into)
+{
+	auto src = ovector<double>::with_max_size_or_null(100);
+	auto dst = ovector<double>::with_max_size_or_null(100);
+	dst.push_back(-1);
+
+	for(int i = 0; i != 100; ++i)
+		src.push_back(i);
+
+	auto n = mgrech::compact_into(dst, src, mgrech::compare_op::greater_equal, 50.0);
+
+	ASSERT_EQ(n, 50);
+	ASSERT_EQ(dst.size(), 51);
+	ASSERT_EQ(dst[0], -1);
+
+	for(int i = 0; i != 50; ++i)
+		ASSERT_EQ(dst[i + 1], i + 50);
+}
+
+#ifdef __linux__
+TEST(ovector, snapshot)
+{
+	mgrech::ovector_options options;
+	options.snapshots = true;
+
+	auto v = ovector<int>::with_max_size_or_null(2 * 1024 * 1024, options);
+	ASSERT_NE(v.data(), nullptr);
+
+	for(int i = 0; i != 10000; ++i)
+		v.push_back(i);
+
+	auto s1 = v.snapshot();
+	ASSERT_NE(s1.data(), nullptr);
+	ASSERT_NE(s1.data(), v.data());
+
+	v[0] = -1;
+	v[5000] = -1;
+
+	for(int i = 10000; i != 20000; ++i)
+		v.push_back(i);
+
+	auto s2 = v.snapshot();
+	v[1] = -1;
+
+	ASSERT_EQ(s1.size(), 10000);
+	ASSERT_EQ(s2.size(), 20000);
+
+	for(int i = 0; i != 10000; ++i)
+		ASSERT_EQ(s1[i], i);
+
+	for(int i = 0; i != 20000; ++i)
+		ASSERT_EQ(s2[i], i == 0 || i == 5000 ? -1 : i);
+
+	v = ovector<int>();
+	ASSERT_EQ(s2[19999], 19999);
+}
+
+TEST(ovector, snapshot_repeated)
+{
+	mgrech::ovector_options options;
+	options.snapshots = true;
+
+	auto v = ovector<int>::with_max_size_or_null(2 * 1024 * 1024, options);
+	ASSERT_NE(v.data(), nullptr);
+
+	for(int i = 0; i != 10000; ++i)
+		v.push_back(i);
+
+	// every snapshot writes the pages modified since the previous one back to the file, which the earlier
+	// snapshots must not see
+	auto s1 = v.snapshot();
+	v[0] = -1;
+	v.push_back(10000);
+
+	auto s2 = v.snapshot();
+	v[0] = -2;
+	v[9000] = -2;
+
+	auto s3 = v.snapshot();
+	s2 = mgrech::ovector_snapshot<int>();
+	v[0] = -3;
+	v[9000] = -3;
+
+	while(v.size() != 5000)
+		v.pop_back();
+
+	for(int i = 5000; i != 30000; ++i)
+		v.push_back(i);
+
+	auto s4 = v.snapshot();
+	v[0] = -4;
+
+	ASSERT_EQ(s1.size(), 10000);
+	ASSERT_EQ(s3.size(), 10001);
+	ASSERT_EQ(s4.size(), 30000);
+
+	for(int i = 0; i != 10000; ++i)
+		ASSERT_EQ(s1[i], i);
+
+	for(int i = 0; i != 10001; ++i)
+		ASSERT_EQ(s3[i], i == 0 || i == 9000 ? -2 : i);
+
+	for(int i = 0; i != 30000; ++i)
+		ASSERT_EQ(s4[i], i == 0 ? -3 : i);
+}
+
+TEST(ovector, snapshot_alignment_canary)
+{
+	mgrech::ovector_options options;
+	options.alignment = 4096;
+	options.snapshots = true;
+
+	// the first snapshot replaces the pages beyond it, including the one holding the canary
+	auto v = ovector<int>::with_max_size_or_null(10000, options);
+
+	for(int i = 0; i != 10; ++i)
+		v.push_back(i);
+
+	auto s1 = v.snapshot();
+
+	while(v.size() != v.max_size())
+		v.push_back(0);
+
+	auto s2 = v.snapshot();
+	ASSERT_EQ(s1[9], 9);
+	ASSERT_EQ(s2.size(), 10000);
+
+	ASSERT_DEATH({ v.data()[10000] = 0; v = ovector<int>(); }, "write past the end");
+	v = ovector<int>();
+}
+#endif
+
+typedef std::vector<std::pair<std::size_t, std::size_t>> dirty_ranges;
+
+template <typename T>
+dirty_ranges collect_dirty(ovector<T> const& v)
+{
+	dirty_ranges ranges;
+	v.collect_dirty_ranges([&](std::size_t first, std::size_t last) { ranges.emplace_back(first, last); });
+	return ranges;
+}
+
+#ifdef __linux__
+void check_dirty_tracking(mgrech::dirty_tracking tracking)
+{
+	mgrech::ovector_options options;
+	options.track_dirty_pages = tracking;
+
+	// 1024 ints per page, the allocation is page aligned
+	auto v = ovector<int>::with_max_size_or_null(2 * 1024 * 1024, options);
+	ASSERT_NE(v.data(), nullptr);
+	ASSERT_TRUE(collect_dirty(v).empty());
+
+	for(int i = 0; i != 10000; ++i)
+		v.push_back(i);
+
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{0, 10000}}));
+	auto unchanged = collect_dirty(v);
+
+	// automatic does not track anything where userfaultfd write-protection is not available
+	if(tracking == mgrech::dirty_tracking::automatic && unchanged == dirty_ranges({{0, 10000}}))
+		return;
+
+	ASSERT_TRUE(unchanged.empty());
+
+	v[0] = -1;
+	v[5000] = -1;
+	v[5001] = -1;
+	v[7168] = -1;
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{0, 1024}, {4096, 5120}, {7168, 8192}}));
+
+	// the last page below the watermark was written to, the appended elements are reported with it
+	for(int i = 0; i != 2500; ++i)
+		v.push_back(i);
+
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{9216, 12500}}));
+
+	// tracking is per page, the range is clamped to the size
+	v[12499] = 0;
+	v.pop_back();
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{12288, 12499}}));
+	ASSERT_TRUE(collect_dirty(v).empty());
+
+	ASSERT_EQ(v[5000], -1);
+	ASSERT_EQ(v[9999], 9999);
+}
+
+TEST(ovector, dirty_tracking)
+{
+	check_dirty_tracking(mgrech::dirty_tracking::automatic);
+	check_dirty_tracking(mgrech::dirty_tracking::mprotect);
+}
+
+// policy of the mapping containing address
+int numa_policy_at(void const* address)
+{
+	int mode = -1;
+	unsigned long nodes[16];
+
+	if(syscall(SYS_get_mempolicy, &mode, nodes, sizeof(nodes) * 8, address, MPOL_F_ADDR) == -1)
+		return -1;
+
+	return mode;
+}
+
+TEST(ovector, numa_placement)
+{
+	mgrech::ovector_options options;
+	options.placement = mgrech::numa_policy::interleave;
+	auto v = ovector<int>::with_max_size_or_null(2 * 1024 * 1024, options);
+	ASSERT_NE(v.data(), nullptr);
+
+	if(numa_policy_at(v.data()) != MPOL_INTERLEAVE)
+		GTEST_SKIP() << "numa policies not supported";
+
+	ASSERT_EQ(numa_policy_at(v.data() + 1024 * 1024 - 1), MPOL_INTERLEAVE);
+
+	// the partition is rounded out to pages of 1024 ints
+	ASSERT_TRUE(v.set_numa_policy(256 * 1024 + 1, 512 * 1024, mgrech::numa_policy::bind, 1));
+	ASSERT_EQ(numa_policy_at(v.data() + 256 * 1024 - 1), MPOL_INTERLEAVE);
+	ASSERT_EQ(numa_policy_at(v.data() + 256 * 1024), MPOL_BIND);
+	ASSERT_EQ(numa_policy_at(v.data() + 512 * 1024 - 1), MPOL_BIND);
+	ASSERT_EQ(numa_policy_at(v.data() + 512 * 1024), MPOL_INTERLEAVE);
+
+	ASSERT_TRUE(v.set_numa_policy(0, 1024, mgrech::numa_policy::local));
+	ASSERT_EQ(numa_policy_at(v.data()), MPOL_LOCAL);
+	ASSERT_TRUE(v.set_numa_policy(0, 1024, mgrech::numa_policy::inherit));
+	ASSERT_EQ(numa_policy_at(v.data()), MPOL_DEFAULT);
+
+	for(int i = 0; i != 1024 * 1024; ++i)
+		v.push_back(i);
+
+	ASSERT_EQ(v[300 * 1024], 300 * 1024);
+
+	options.placement = mgrech::numa_policy::bind;
+	options.placement_nodes = 1;
+	ASSERT_EQ(numa_policy_at(ovector<int>::with_max_size_or_null(16, options).data()), MPOL_BIND);
+}
+#endif
+
+TEST(ovector, dirty_tracking_disabled)
+{
+	auto v = ovector<int>::with_max_size_or_null(16);
+	ASSERT_TRUE(collect_dirty(v).empty());
+
+	v.push_back(1);
+	v.push_back(2);
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{0, 2}}));
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{0, 2}}));
+
+	v.trim_front(1);
+	ASSERT_EQ(collect_dirty(v), dirty_ranges({{1, 2}}));
+	ASSERT_TRUE(collect_dirty(ovector<int>()).empty());
+}
+
+TEST(ovector, access_hints)
+{
+	auto v = ovector<int>::with_max_size_or_null(1024 * 1024);
+
+	ASSERT_TRUE(v.advise(mgrech::access_hint::sequential));
+	ASSERT_TRUE(v.advise(1000, 2000, mgrech::access_hint::random));
+	ASSERT_TRUE(v.advise(mgrech::access_hint::normal));
+	ASSERT_FALSE(v.advise(10, 10, mgrech::access_hint::will_need));
+	ASSERT_FALSE(ovector<int>().advise(mgrech::access_hint::normal));
+
+	for(int i = 0; i != 1024 * 1024; ++i)
+		v.push_back(i);
+
+	// no page lies entirely within a range smaller than one
+	ASSERT_FALSE(v.mark_cold(1, 1000));
+
+#ifdef __linux__
+	if(!v.mark_cold(0, 512 * 1024))
+		GTEST_SKIP() << "MADV_COLD not supported";
+
+	ASSERT_TRUE(v.mark_cold(512 * 1024, v.max_size(), true));
+	ASSERT_TRUE(v.mark_cold(1, v.max_size()));
+
+	for(int i = 0; i < 1024 * 1024; i += 1000)
+		ASSERT_EQ(v[i], i);
+#endif
+}
+
+TEST(ovector, demote_cold_prefix)
+{
+	mgrech::ovector_options options;
+	options.demote_behind_pages = 16;
+
+	auto v = ovector<int>::with_max_size_or_null(2 * 1024 * 1024, options);
+
+	// demotion is supported only on linux 5.4 and later, but never enabled without the option
+	ASSERT_FALSE(ovector<int>::with_max_size_or_null(1024).demote_cold_prefix());
+	ASSERT_FALSE(ovector<int>().demote_cold_prefix());
+
+	for(int i = 0; i != 1024 * 1024; ++i)
+	{
+		v.push_back(i);
+
+		if(i % 4096 == 0)
+			v.demote_cold_prefix();
+	}
+
+	v.erase(v.begin(), v.begin() + 1000);
+	int const tail[] = {7, 7, 7};
+	v.insert(v.end(), tail, tail + 3);
+
+	auto w = ovector<int>::with_max_size_or_null(16);
+	w = std::move(v);
+
+	for(int i = 0; i != 1000; ++i)
+		w.push_back(i);
+
+	auto enabled = w.demote_cold_prefix();
+	ASSERT_EQ(v.demote_cold_prefix(), false);
+	ASSERT_EQ(w.size(), 1024 * 1024 + 3);
+
+	for(int i = 0; i != 1024 * 1024 - 1000; ++i)
+		ASSERT_EQ(w[i], i + 1000);
+
+	// the refilled prefix is demoted again
+	w.clear();
+	ASSERT_EQ(w.demote_cold_prefix(), enabled);
+
+	for(int i = 0; i != 512 * 1024; ++i)
+	{
+		w.push_back(-i);
+
+		if(i % 4096 == 0)
+			w.demote_cold_prefix();
+	}
+
+	ASSERT_EQ(w.size(), 512 * 1024);
+	ASSERT_EQ(w[0], 0);
+	ASSERT_EQ(w[512 * 1024 - 1], -(512 * 1024 - 1));
+}
+
+#ifdef __linux__
+static
+std::size_t resident_pages(void const* first, void const* last)
+{
+	auto page = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+	auto begin = (std::uintptr_t)first / page * page;
+	auto end = ((std::uintptr_t)last + page - 1) / page * page;
+	std::vector<unsigned char> pages((end - begin) / page);
+
+	if(mincore((void*)begin, end - begin, pages.data()) != 0)
+		return ~std::size_t();
+
+	std::size_t n = 0;
+
+	for(auto p : pages)
+		n += p & 1;
+
+	return n;
+}
+
+static
+std::size_t resident_set_pages()
+{
+	std::size_t size = 0;
+	std::size_t resident = 0;
+	auto file = std::fopen("/proc/self/statm", "r");
+
+	if(file)
+	{
+		if(std::fscanf(file, "%zu %zu", &size, &resident) != 2)
+			resident = 0;
+
+		std::fclose(file);
+	}
+
+	return resident;
+}
+#endif
+
+TEST(ovector, trim_front)
+{
+	auto v = ovector<int>::with_max_size_or_null(1024 * 1024);
+
+	for(int i = 0; i != 1024 * 1024; ++i)
+		v.push_back(i);
+
+	auto p = &v[600000];
+	v.trim_front(0);
+	v.trim_front(500000);
+	v.trim_front(100000);
+
+	ASSERT_EQ(v.first_index(), 600000);
+	ASSERT_EQ(v.size(), 1024 * 1024);
+	ASSERT_EQ(v.begin(), v.data() + 600000);
+	ASSERT_EQ(&v.front(), p);
+	ASSERT_EQ(v[600000], 600000);
+	ASSERT_EQ(v.back(), 1024 * 1024 - 1);
+	ASSERT_EQ(mgrech::count(v, 5), 0);
+	ASSERT_EQ(mgrech::min_value(v), 600000);
+	ASSERT_EQ(*mgrech::find(v, 700000), 700000);
+
+#ifdef __linux__
+	// 1024 elements per page, the page holding element 600000 stays
+	ASSERT_EQ(resident_pages(v.data(), v.data() + 585 * 1024), 0);
+	ASSERT_EQ(resident_pages(v.data() + 586 * 1024, v.data() + 1024 * 1024), 1024 - 586);
+#endif
+
+	ASSERT_EQ(v.erase_if([](int x) { return x % 2 == 0; }), (1024 * 1024 - 600000) / 2);
+	ASSERT_EQ(v[600000], 600001);
+
+	auto w = std::move(v);
+	ASSERT_EQ(w.first_index(), 600000);
+	ASSERT_EQ(v.first_index(), 0);
+	ASSERT_TRUE(v.empty());
+
+	w.trim_front(w.size() - w.first_index());
+	ASSERT_TRUE(w.empty());
+
+	w.clear();
+	ASSERT_EQ(w.first_index(), 0);
+	w.push_back(1);
+	ASSERT_EQ(w[0], 1);
+}
+
+TEST(ovector, trim_front_nontrivial)
+{
+	auto v = ovector<dtor_counted>::with_max_size_or_null(5);
+
+	for(int i = 0; i != 5; ++i)
+		v.emplace_back();
+
+	global::dtor_count = 0;
+	v.trim_front(2);
+	ASSERT_EQ(global::dtor_count, 2);
+	ASSERT_EQ(v.end() - v.begin(), 3);
+
+	v.clear();
+	ASSERT_EQ(global::dtor_count, 5);
+	ASSERT_TRUE(v.empty());
+}
+
+#ifdef __linux__
+TEST(ovector, fork_policy)
+{
+	// aligned, so that the storage ends in a canary
+	auto make = [](mgrech::fork_policy policy)
+	{
+		mgrech::ovector_options options;
+		options.alignment = 64;
+		options.on_fork = policy;
+		auto v = ovector<std::uint64_t>::with_max_size_or_null(1000001, options);
+
+		for(std::uint64_t i = 0; i != 100001; ++i)
+			v.push_back(i + 1);
+
+		return v;
+	};
+
+	auto inherited = make(mgrech::fork_policy::inherit);
+	auto not_forked = make(mgrech::fork_policy::dont_fork);
+	auto wiped = make(mgrech::fork_policy::wipe_on_fork);
+	ASSERT_NE(inherited.data(), nullptr);
+	ASSERT_NE(not_forked.data(), nullptr);
+	ASSERT_NE(wiped.data(), nullptr);
+
+	auto pid = fork();
+	ASSERT_NE(pid, -1);
+
+	// assertions do not work in the child, it reports the number of failed checks as its exit status instead
+	if(pid == 0)
+	{
+		int failures = inherited.size() != 100001 || inherited[100000] != 100001;
+
+		for(auto v : {&not_forked, &wiped})
+		{
+			failures += v->size() != 100001 || (*v)[0] != 0 || (*v)[100000] != 0;
+			v->reset_after_fork();
+			failures += !v->empty();
+			v->push_back(42);
+			failures += v->size() != 1 || (*v)[0] != 42;
+		}
+
+		// releasing the storage checks the canaries
+		not_forked = ovector<std::uint64_t>();
+		wiped = ovector<std::uint64_t>();
+		_exit(failures);
+	}
+
+	int status = 0;
+	ASSERT_EQ(waitpid(pid, &status, 0), pid);
+	ASSERT_TRUE(WIFEXITED(status));
+	ASSERT_EQ(WEXITSTATUS(status), 0);
+
+	ASSERT_EQ(not_forked[100000], 100001);
+	ASSERT_EQ(wiped[100000], 100001);
+	not_forked.push_back(0);
+	wiped.push_back(0);
+}
+#endif
+
+TEST(ovector, snapshot_unsupported)
+{
+	auto v = ovector<int>::with_max_size_or_null(16);
+	v.push_back(1);
+
+	ASSERT_EQ(v.snapshot().data(), nullptr);
+	ASSERT_EQ(ovector<int>().snapshot().data(), nullptr);
+}
+
+TEST(sparse_ovector, set_erase)
+{
+	// 1 TiB of address space
+	auto v = mgrech::sparse_ovector<std::uint64_t>::with_max_size_or_null(std::uint64_t(1) << 37);
+	ASSERT_NE(v.data(), nullptr);
+	ASSERT_TRUE(v.empty());
+
+	std::uint64_t const ids[] = {0, 1, 511, 512, 123456789, (std::uint64_t(1) << 37) - 1};
+
+	for(auto id : ids)
+		v.set(id, id + 1);
+
+	v.set(1, 7);
+	ASSERT_EQ(v.size(), 6);
+	ASSERT_EQ(v.populated_pages(), 4);
+	ASSERT_EQ(v[1], 7);
+	ASSERT_EQ(v[123456789], 123456790);
+	ASSERT_EQ(v[987654321], 0);
+	ASSERT_TRUE(v.contains(511));
+	ASSERT_FALSE(v.contains(510));
+
+	std::vector<std::uint64_t> visited;
+	v.for_each([&](std::uint64_t index, std::uint64_t value)
+	{
+		visited.push_back(index);
+		ASSERT_EQ(value, index == 1 ? 7 : index + 1);
+	});
+	ASSERT_EQ(visited, std::vector<std::uint64_t>(ids, ids + 6));
+
+	v.erase(511);
+	v.set(0, 0);
+	ASSERT_EQ(v.size(), 4);
+	ASSERT_EQ(v.populated_pages(), 4);
+
+	v.erase(123456789);
+	ASSERT_EQ(v.size(), 3);
+	ASSERT_EQ(v.populated_pages(), 3);
+
+#ifdef __linux__
+	ASSERT_EQ(resident_pages(v.data() + 123456789, v.data() + 123456790), 0);
+	ASSERT_EQ(resident_pages(v.data() + 512, v.data() + 513), 1);
+#endif
+
+	v.erase(123456789);
+	ASSERT_EQ(v.size(), 3);
+	ASSERT_EQ(v[123456789], 0);
+
+	v.clear();
+	ASSERT_TRUE(v.empty());
+	ASSERT_EQ(v.populated_pages(), 0);
+	ASSERT_EQ(v[512], 0);
+
+	v.set(5, 5);
+	ASSERT_EQ(v.size(), 1);
+	ASSERT_EQ(v.populated_pages(), 1);
+
+	// writing an empty value over an empty element does not commit its page. reading it maps the shared zero page,
+	// which mincore reports as resident but the resident set does not include.
+#ifdef __linux__
+	auto resident = resident_set_pages();
+#endif
+
+	for(std::uint64_t i = 0; i != 1024; ++i)
+		v.set(1000000 + i * 512, 0);
+
+	ASSERT_EQ(v.size(), 1);
+	ASSERT_EQ(v.populated_pages(), 1);
+
+#ifdef __linux__
+	ASSERT_LT(resident_set_pages() - resident, 512);
+#endif
+}
+
+TEST(sparse_ovector, straddling_elements)
+{
+	struct record
+	{
+		std::uint64_t a, b, c;
+	};
+
+	auto v = mgrech::sparse_ovector<record>::with_max_size_or_null(1000);
+
+	// bytes [4080, 4104) overlap the first two pages
+	v.set(170, {1, 2, 3});
+	v.set(999, {0, 0, 1});
+	ASSERT_EQ(v.populated_pages(), 3);
+	ASSERT_EQ(v[170].b, 2);
+
+	int visits = 0;
+	v.for_each([&](std::uint64_t index, record const& r)
+	{
+		++visits;
+		ASSERT_TRUE(index == 170 || index == 999);
+		ASSERT_NE(r.a + r.b + r.c, 0);
+	});
+	ASSERT_EQ(visits, 2);
+
+	v.erase(170);
+	ASSERT_EQ(v.populated_pages(), 1);
+	ASSERT_EQ(v[170].c, 0);
+
+	// the last page is partly taken by the end of the storage and not released, but cleared
+	v.erase(999);
+	ASSERT_EQ(v.populated_pages(), 0);
+	ASSERT_EQ(v[999].c, 0);
+	ASSERT_TRUE(v.empty());
+}
+
+TEST(sorted_ovector, insert_find)
+{
+	auto s = mgrech::sorted_ovector<std::uint32_t>::with_buffer_size_or_null(16);
+	ASSERT_EQ(s.buffer_size(), 16);
+	std::vector<std::uint32_t> expected;
+	std::uint32_t x = 1;
+
+	// a multiplicative sequence mod 1021 repeats values, so some elements occur several times
+	for(int i = 0; i != 5000; ++i)
+	{
+		x = x * 7 % 1021;
+		ASSERT_TRUE(s.insert(x));
+		expected.push_back(x);
+	}
+
+	std::sort(expected.begin(), expected.end());
+	ASSERT_EQ(s.size(), 5000);
+	// 312 sealed buffers in base 4 are 10320, one run per digit
+	ASSERT_EQ(s.run_count(), 6);
+
+	for(std::uint32_t key = 0; key != 1100; ++key)
+	{
+		auto n = (std::size_t)std::count(expected.begin(), expected.end(), key);
+		ASSERT_EQ(s.count(key), n);
+		ASSERT_EQ(s.contains(key), n != 0);
+
+		if(n != 0)
+			ASSERT_EQ(*s.find(key), key);
+		else
+			ASSERT_EQ(s.find(key), nullptr);
+	}
+
+	std::vector<std::uint32_t> visited;
+	s.for_each([&](std::uint32_t value) { visited.push_back(value); });
+	ASSERT_EQ(visited, expected);
+
+	ASSERT_TRUE(s.compact());
+	ASSERT_EQ(s.run_count(), 1);
+	ASSERT_EQ(s.size(), 5000);
+	ASSERT_EQ(s.count(expected.back()), (std::size_t)std::count(expected.begin(), expected.end(), expected.back()));
+
+	// the oldest run is not merged again until there are fanout runs of its tier
+	auto p = s.find(expected[2500]);
+
+	for(int i = 0; i != 64; ++i)
+		ASSERT_TRUE(s.insert((std::uint32_t)i));
+
+	ASSERT_EQ(s.find(expected[2500]), p);
+
+	auto t = std::move(s);
+	ASSERT_TRUE(s.empty());
+	ASSERT_EQ(t.size(), 5064);
+}
+
+TEST(sorted_ovector, nontrivial)
+{
+	auto s = mgrech::sorted_ovector<std::string>::with_buffer_size_or_null(4);
+
+	for(int i = 0; i != 100; ++i)
+		ASSERT_TRUE(s.insert(std::to_string(i % 50) + std::string(32, 'x')));
+
+	ASSERT_EQ(s.count("7" + std::string(32, 'x')), 2);
+	ASSERT_EQ(s.find("100" + std::string(32, 'x')), nullptr);
+
+	std::string previous;
+	std::size_t n = 0;
+
+	s.for_each([&](std::string const& value)
+	{
+		ASSERT_LE(previous, value);
+		previous = value;
+		++n;
+	});
+
+	ASSERT_EQ(n, 100);
+	ASSERT_TRUE(s.compact());
+	ASSERT_EQ(s.run_count(), 1);
+	ASSERT_TRUE(s.contains("49" + std::string(32, 'x')));
+}
+
+TEST(ovector_stream, wait_until_size)
+{
+	auto s = mgrech::ovector_stream<int>::with_max_size_or_null(100000);
+	ASSERT_EQ(s.size(), 0);
+	ASSERT_TRUE(s.wait_until_size(0));
+	ASSERT_FALSE(s.wait_until_size(1, std::chrono::milliseconds(1)));
+
+	std::thread producer([&]
+	{
+		for(int i = 0; i != 50000; ++i)
+			s.push_back(i);
+
+		int const tail[] = {1, 2, 3};
+
+		// let the consumer block before the rest is appended
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		s.append(tail, tail + 3);
+		s.close();
+	});
+
+	for(int i = 0; i < 50000; i += 97)
+	{
+		ASSERT_TRUE(s.wait_until_size(i + 1));
+		ASSERT_EQ(s[i], i);
+	}
+
+	ASSERT_TRUE(s.wait_until_size(50003, std::chrono::seconds(10)));
+	ASSERT_EQ(s[50002], 3);
+	ASSERT_FALSE(s.wait_until_size(50004));
+	ASSERT_TRUE(s.closed());
+	producer.join();
+
+	auto t = std::move(s);
+	ASSERT_EQ(t.size(), 50003);
+	ASSERT_TRUE(t.closed());
+	ASSERT_EQ(s.data(), nullptr);
+	ASSERT_EQ(s.size(), 0);
+}
+
+#ifdef OVECTOR_COROUTINES
+struct detached_task
+{
+	struct promise_type
+	{
+		detached_task get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+static
+detached_task consume(mgrech::ovector_stream<int> const& s, std::vector<int>& seen, bool& done)
+{
+	for(mgrech::ovector_stream<int>::size_type i = 0; co_await s.async_wait_until_size(i + 1); ++i)
+		seen.push_back(s[i]);
+
+	done = true;
+}
+
+TEST(ovector_stream, coroutine)
+{
+	auto s = mgrech::ovector_stream<int>::with_max_size_or_null(16);
+	std::vector<int> seen;
+	bool done = false;
+
+	s.push_back(1);
+	consume(s, seen, done);
+	ASSERT_EQ(seen, std::vector<int>({1}));
+
+	s.push_back(2);
+	s.push_back(3);
+	ASSERT_EQ(seen, std::vector<int>({1, 2, 3}));
+	ASSERT_FALSE(done);
+
+	s.close();
+	ASSERT_TRUE(done);
+}
+#endif
+
+#ifdef OVECTOR_MEMORY_RESOURCE
+TEST(ovector_memory_resource, allocate_release)
+{
+	auto r = mgrech::ovector_memory_resource::with_max_size_or_null(64 * 1024);
+	ASSERT_NE(r.data(), nullptr);
+
+	auto p1 = r.allocate(3, 1);
+	auto p2 = r.allocate(8, 8);
+	auto p3 = r.allocate(64, 64);
+	ASSERT_EQ(p1, r.data());
+	ASSERT_EQ((std::uintptr_t)p2 % 8, 0);
+	ASSERT_EQ((std::uintptr_t)p3 % 64, 0);
+	ASSERT_LT(p2, p3);
+	r.deallocate(p2, 8, 8);
+
+	{
+		std::pmr::vector<int> v(&r);
+
+		for(int i = 0; i != 1000; ++i)
+			v.push_back(i);
+
+		ASSERT_GE((char const*)v.data(), (char const*)r.data());
+		ASSERT_LE((char const*)(v.data() + v.size()), (char const*)r.data() + r.size());
+	}
+
+	ASSERT_THROW((void)r.allocate(64 * 1024, 1), std::bad_alloc);
+
+	r.release(true);
+	ASSERT_EQ(r.size(), 0);
+	ASSERT_EQ(r.allocate(64 * 1024, 1), r.data());
+	ASSERT_EQ(r.size(), r.max_size());
+	ASSERT_THROW((void)r.allocate(1, 1), std::bad_alloc);
+
+	r.release();
+	ASSERT_EQ(r.allocate(16, 16), r.data());
+}
+#endif
+
+TEST(obitvector, popcount_kernels)
+{
+	using mgrech::detail::kernel_isa;
+
+	auto best = mgrech::detail::detect_kernel_isa();
+	kernel_isa const isas[] = {kernel_isa::scalar, kernel_isa::sse42, kernel_isa::avx2};
+
+	// more than 31 vectors of 4 words, so the avx2 byte counters are flushed
+	std::uint64_t words[300];
+	std::size_t expected[301] = {};
+
+	for(std::size_t i = 0; i != 300; ++i)
+	{
+		words[i] = (i * 0x9e3779b97f4a7c15u) ^ (i << 17);
+		expected[i + 1] = expected[i] + std::bitset<64>(words[i]).count();
+	}
+
+	for(auto isa : isas)
+	{
+		if(isa > best)
+			break;
+
+		auto popcount = mgrech::detail::popcount_kernel_for(isa);
+
+		for(std::size_t n = 0; n <= 300; ++n)
+			ASSERT_EQ(popcount(words, n), expected[n]);
+	}
+}
+
+void check_bits(mgrech::obitvector const& v, std::vector<bool> const& expected)
+{
+	ASSERT_EQ(v.size(), expected.size());
+
+	std::size_t ones = 0;
+
+	for(std::size_t i = 0; i != expected.size(); ++i)
+	{
+		ASSERT_EQ(v.rank(i), ones);
+		ASSERT_EQ(v[i], expected[i]);
+
+		if(expected[i])
+		{
+			ASSERT_EQ(v.select(ones++), i);
+		}
+	}
+
+	ASSERT_EQ(v.rank(v.size()), ones);
+	ASSERT_EQ(v.count(), ones);
+	ASSERT_EQ(v.select(ones), v.size());
+}
+
+void check_obitvector(bool rank_index)
+{
+	auto v = mgrech::obitvector::with_max_size_or_null(5000, rank_index);
+	ASSERT_NE(v.data(), nullptr);
+	ASSERT_EQ(v.has_rank_index(), rank_index);
+	ASSERT_EQ(v.max_size(), 5000);
+
+	std::vector<bool> expected;
+
+	for(std::size_t i = 0; i != 3000; ++i)
+	{
+		bool bit = (i * i + i / 7) % 3 == 0;
+		v.push_back(bit);
+		expected.push_back(bit);
+	}
+
+	check_bits(v, expected);
+
+	// modifying appended bits invalidates the rank index from there on
+	v.set(10);
+	v.reset(1500);
+	v.flip(2999);
+	expected[10] = true;
+	expected[1500] = false;
+	expected[2999] = !expected[2999];
+	check_bits(v, expected);
+
+	v.update_rank_index();
+	check_bits(v, expected);
+
+	for(std::size_t i = 0; i != 20; ++i)
+	{
+		std::uint64_t word = 0xf0f0f0f0f0f0f0f0u + i;
+		v.append_word(word, i * 3);
+
+		for(std::size_t j = 0; j != i * 3; ++j)
+			expected.push_back((word >> j) & 1);
+	}
+
+	check_bits(v, expected);
+
+	v.pop_back();
+	v.pop_back();
+	expected.pop_back();
+	expected.pop_back();
+	check_bits(v, expected);
+
+	v.flip();
+	expected.flip();
+	check_bits(v, expected);
+
+	v.clear();
+	ASSERT_TRUE(v.empty());
+	ASSERT_EQ(v.count(), 0);
+	v.push_back(true);
+	ASSERT_EQ(v.count(), 1);
+	ASSERT_EQ(v.select(0), 0);
+}
+
+TEST(obitvector, bits)
+{
+	check_obitvector(false);
+	check_obitvector(true);
+}
+
+TEST(obitvector, bulk)
+{
+	auto a = mgrech::obitvector::with_max_size_or_null(200);
+	auto b = mgrech::obitvector::with_max_size_or_null(200);
+
+	for(std::size_t i = 0; i != 130; ++i)
+	{
+		a.push_back(i % 2 == 0);
+		b.push_back(i % 3 == 0);
+	}
+
+	a &= b;
+	ASSERT_EQ(a.count(), 22);
+	a |= b;
+	ASSERT_EQ(a.count(), 44);
+	a ^= b;
+	ASSERT_EQ(a.count(), 0);
+
+	mgrech::obitvector c;
+	ASSERT_EQ(c.data(), nullptr);
+	ASSERT_EQ(c.count(), 0);
+	swap(a, c);
+	ASSERT_EQ(a.data(), nullptr);
+	ASSERT_EQ(c.size(), 130);
+}